@@ -7,6 +7,7 @@
 const {Helper} = ChromeUtils.importESModule('chrome://juggler/content/Helper.js');
 const {NetUtil} = ChromeUtils.importESModule('resource://gre/modules/NetUtil.sys.mjs');
 const { ChannelEventSinkFactory } = ChromeUtils.importESModule("chrome://juggler/content/ChannelEventSink.sys.mjs");
+const {Binary} = ChromeUtils.importESModule("chrome://juggler/content/protocol/PrimitiveTypes.js");
 
 
 const Cc = Components.classes;
@@ -937,7 +938,7 @@ class ResponseStorage {
       for (const encoding of response.encodings)
         result = convertString(result, encoding, 'uncompressed', response.httpChannel);
     }
-    return {base64body: btoa(result)};
+    return {base64body: new Binary(result)};
   }
 }
 
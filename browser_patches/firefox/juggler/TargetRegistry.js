@@ -7,6 +7,7 @@ const {Preferences} = ChromeUtils.importESModule("resource://gre/modules/Prefere
 const {ContextualIdentityService} = ChromeUtils.importESModule("resource://gre/modules/ContextualIdentityService.sys.mjs");
 const {NetUtil} = ChromeUtils.importESModule('resource://gre/modules/NetUtil.sys.mjs');
 const {AppConstants} = ChromeUtils.importESModule("resource://gre/modules/AppConstants.sys.mjs");
+const {Binary} = ChromeUtils.importESModule("chrome://juggler/content/protocol/PrimitiveTypes.js");
 
 const Cr = Components.results;
 
@@ -106,6 +107,7 @@ class DownloadInterceptor {
 }
 
 const screencastService = Cc['@mozilla.org/juggler/screencast;1'].getService(Ci.nsIScreencastService);
+const remoteDebuggingPipe = Cc['@mozilla.org/juggler/remotedebuggingpipe;1'].getService(Ci.nsIRemoteDebuggingPipe);
 
 export class TargetRegistry {
   static instance() {
@@ -427,6 +429,7 @@ export class PageTarget {
     this._actor = undefined;
     this._channel = new SimpleChannel(`browser::page[${this._targetId}]`, 'target-' + this._targetId);
     this._screencastId = undefined;
+    this._videoRecording = undefined;
     this._dialogs = new Map();
     this.forcedColors = 'none';
     this.disableCache = false;
@@ -813,33 +816,77 @@ export class PageTarget {
     await this._channel.connect('').send('applyContextSetting', { name, value }).catch(e => void e);
   }
 
-  async startScreencast({ width, height, quality }) {
-    if (this._screencastId)
-      return;
+  async _prepareScreencast({ width, height, fps }) {
     // On Mac the window may not yet be visible when TargetCreated and its
     // NSWindow.windowNumber may be -1, so we wait until the window is known
     // to be initialized and visible.
     await this.windowReady();
     if (width < 10 || width > 10000 || height < 10 || height > 10000)
       throw new Error("Invalid size");
+    if (fps !== undefined && (fps < 1 || fps > 60))
+      throw new Error("Invalid fps");
 
     const docShell = this._gBrowser.documentGlobal.docShell;
     // Exclude address bar and navigation control from the video.
     const rect = this.linkedBrowser().getBoundingClientRect();
     const devicePixelRatio = this._window.devicePixelRatio;
+    const viewport = this._viewportSize || this._browserContext.defaultViewportSize || { width: 0, height: 0 };
+    return { docShell, viewport, offsetTop: devicePixelRatio * rect.top };
+  }
+
+  async startScreencast({ width, height, quality, fps, maxFramesInFlight, partialFrames }) {
+    if (this._screencastId)
+      return;
+    if (maxFramesInFlight !== undefined && (maxFramesInFlight < 1 || maxFramesInFlight > 16))
+      throw new Error("Invalid maxFramesInFlight");
+    const { docShell, viewport, offsetTop } = await this._prepareScreencast({ width, height, fps });
 
+    // JPEGs go over the pipe as they are when it takes binary attachments.
+    const rawFrames = remoteDebuggingPipe.binaryAttachments;
     const self = this;
     const screencastClient = {
       QueryInterface: ChromeUtils.generateQI([Ci.nsIScreencastServiceClient]),
       screencastFrame(data, deviceWidth, deviceHeight, timestamp) {
         if (self._screencastId)
-          self.emit(PageTarget.Events.ScreencastFrame, { data, deviceWidth, deviceHeight, timestamp });
+          self.emit(PageTarget.Events.ScreencastFrame, { data: rawFrames ? new Binary(data) : data, deviceWidth, deviceHeight, timestamp });
+      },
+      screencastTiles(data, rects, deviceWidth, deviceHeight, timestamp) {
+        if (!self._screencastId)
+          return;
+        const tiles = data.map((data, i) => ({ x: rects[4 * i], y: rects[4 * i + 1], width: rects[4 * i + 2], height: rects[4 * i + 3], data: rawFrames ? new Binary(data) : data }));
+        self.emit(PageTarget.Events.ScreencastTiles, { tiles, deviceWidth, deviceHeight, timestamp });
       },
       screencastStopped() {
       },
     };
-    const viewport = this._viewportSize || this._browserContext.defaultViewportSize || { width: 0, height: 0 };
-    this._screencastId = screencastService.startScreencast(screencastClient, docShell, width, height, quality || 90, viewport.width, viewport.height, devicePixelRatio * rect.top);
+    this._screencastId = screencastService.startScreencast(screencastClient, docShell, width, height, quality || 90, viewport.width, viewport.height, offsetTop, fps || 25, maxFramesInFlight || 1, !!partialFrames, rawFrames);
+  }
+
+  async startVideoRecording({ file, width, height, fps }) {
+    if (this._videoRecording)
+      throw new Error('Video recording is already in progress');
+    const { docShell, viewport, offsetTop } = await this._prepareScreencast({ width, height, fps });
+    let onStopped;
+    const stopped = new Promise(f => onStopped = f);
+    const recordingClient = {
+      QueryInterface: ChromeUtils.generateQI([Ci.nsIScreencastServiceClient]),
+      screencastFrame() {},
+      screencastTiles() {},
+      screencastStopped() {
+        onStopped();
+      },
+    };
+    const sessionId = screencastService.startVideoRecording(recordingClient, docShell, file, width, height, viewport.width, viewport.height, offsetTop, fps || 25);
+    this._videoRecording = { sessionId, stopped };
+  }
+
+  async stopVideoRecording() {
+    if (!this._videoRecording)
+      return;
+    const { sessionId, stopped } = this._videoRecording;
+    this._videoRecording = undefined;
+    screencastService.stopScreencast(sessionId);
+    await stopped;
   }
 
   screencastFrameAck() {
@@ -848,6 +895,22 @@ export class PageTarget {
     screencastService.screencastFrameAck(this._screencastId);
   }
 
+  screencastStats() {
+    if (!this._screencastId)
+      throw new Error('Not screencasting');
+    const stats = screencastService.getSessionStats(this._screencastId);
+    return {
+      framesEncoded: stats.framesEncoded,
+      framesDropped: stats.framesDropped,
+      meanLatencyMs: stats.meanLatencyMs,
+      maxLatencyMs: stats.maxLatencyMs,
+      meanEncodeMs: stats.meanEncodeMs,
+      heapAllocations: stats.heapAllocations,
+      ackLatencyMs: stats.ackLatencyMs,
+      frameIntervalMs: stats.frameIntervalMs,
+    };
+  }
+
   stopScreencast() {
     if (!this._screencastId)
       return;
@@ -875,6 +938,7 @@ export class PageTarget {
     this.ensureContextMenuClosed();
     this._disposed = true;
     this.stopScreencast();
+    this.stopVideoRecording();
     this._browserContext.pages.delete(this);
     this._registry._browserToTarget.delete(this._linkedBrowser);
     this._registry._browserIdToTarget.delete(this._browserId);
@@ -894,6 +958,7 @@ export class PageTarget {
 
 PageTarget.Events = {
   ScreencastFrame: Symbol('PageTarget.ScreencastFrame'),
+  ScreencastTiles: Symbol('PageTarget.ScreencastTiles'),
   Crashed: Symbol('PageTarget.Crashed'),
   DialogOpened: Symbol('PageTarget.DialogOpened'),
   DialogClosed: Symbol('PageTarget.DialogClosed'),
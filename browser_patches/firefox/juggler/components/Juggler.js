@@ -124,14 +124,21 @@ export class Juggler {
             if (browserHandler)
               browserHandler['Browser.close']();
           },
-          send(message) {
+          // Framing is negotiated after the pipe starts, check every time.
+          get binaryAttachments() {
+            return pipe.binaryAttachments;
+          },
+          send(message, attachments) {
             if (pipeStopped) {
               // We are missing the response to Browser.close,
               // but everything works fine. Once we actually need it,
               // we have to stop the pipe after the response is sent.
               return;
             }
-            pipe.sendMessage(message);
+            if (attachments.length)
+              pipe.sendMessageWithAttachments(message, attachments);
+            else
+              pipe.sendMessage(message);
           },
         };
         pipe.init(connection);
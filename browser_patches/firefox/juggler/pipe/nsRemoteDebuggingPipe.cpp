@@ -4,19 +4,27 @@
 
 #include "nsRemoteDebuggingPipe.h"
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 #if defined(_WIN32)
 #include <io.h>
 #include <windows.h>
 #else
+#include <limits.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
+#include "mozilla/EndianUtils.h"
 #include "mozilla/StaticPtr.h"
+#include "mozilla/TimeStamp.h"
 #include "nsISupportsPrimitives.h"
 #include "nsThreadUtils.h"
+#include "prenv.h"
+#include "zlib.h"
 
 namespace mozilla {
 
@@ -26,9 +34,36 @@ namespace {
 
 StaticRefPtr<nsRemoteDebuggingPipe> gPipe;
 
-const size_t kWritePacketSize = 1 << 16;
+// Minimum free space for a read, the buffer grows beyond it for messages
+// that do not fit.
+const size_t kReadSize = 256 * 1024;
+// Longest time incoming messages are delivered without yielding.
+const double kMaxDeliveryMs = 8;
+// Upper bound of the first latency bucket, see kLatencyBuckets.
+const double kFirstLatencyBucketMs = 0.25;
+
+// With PW_PIPE_FRAMING=binary or PW_PIPE_COMPRESSION=deflate the browser
+// offers framing by sending this message first, and keeps writing '\0'
+// terminated messages. A driver that takes frames answers with the same
+// message and frames everything it writes after that. Once the answer is read
+// the browser sends the message again and frames everything after it. Drivers
+// that do not answer keep getting '\0' terminated messages. A frame is a
+// little endian uint32 header followed by the payload:
+// - bits 0-29 hold the payload size,
+// - bit 30 marks a binary attachment of the next message,
+// - bit 31 marks a compressed payload: the uint32 size of the message
+//   followed by its zlib stream.
+const char kFramingHandshake[] = "{\"pipeFraming\":1}";
+const size_t kFrameHeaderSize = 4;
+const uint32_t kFrameCompressed = 1u << 31;
+const uint32_t kFrameAttachment = 1u << 30;
+const uint32_t kFrameSizeMask = kFrameAttachment - 1;
+// Smaller messages do not shrink enough to be worth compressing.
+const size_t kMinCompressedSize = 1024;
 
 #if defined(_WIN32)
+const size_t kWritePacketSize = 1 << 16;
+
 HANDLE readHandle;
 HANDLE writeHandle;
 #else
@@ -61,27 +96,62 @@ size_t ReadBytes(void* buffer, size_t size, bool exact_size)
     return bytesRead;
 }
 
-void WriteBytes(const char* bytes, size_t size)
+void EncodeFrame(const nsCString& aMessage, bool aAttachment, bool aCompress, nsCString& aFrame) {
+  // Attachments are mostly images that do not compress any further.
+  if (aCompress && !aAttachment && aMessage.Length() >= kMinCompressedSize) {
+    const size_t prefixSize = kFrameHeaderSize + 4;
+    uLongf compressedSize = compressBound(aMessage.Length());
+    aFrame.SetLength(prefixSize + compressedSize);
+    char* data = aFrame.BeginWriting();
+    int result = compress2(reinterpret_cast<Bytef*>(data + prefixSize), &compressedSize,
+        reinterpret_cast<const Bytef*>(aMessage.BeginReading()), aMessage.Length(), Z_BEST_SPEED);
+    if (result == Z_OK && compressedSize + 4 < aMessage.Length()) {
+      LittleEndian::writeUint32(data, (compressedSize + 4) | kFrameCompressed);
+      LittleEndian::writeUint32(data + kFrameHeaderSize, aMessage.Length());
+      aFrame.SetLength(prefixSize + compressedSize);
+      return;
+    }
+  }
+  aFrame.SetLength(kFrameHeaderSize);
+  LittleEndian::writeUint32(aFrame.BeginWriting(), aMessage.Length() | (aAttachment ? kFrameAttachment : 0));
+  aFrame.Append(aMessage);
+}
+
+bool DecodeFrame(uint32_t aHeader, const char* aPayload, size_t aSize, nsCString& aMessage) {
+  if (!(aHeader & kFrameCompressed)) {
+    aMessage.Assign(aPayload, aSize);
+    return true;
+  }
+  if (aSize < 4)
+    return false;
+  uLongf messageSize = LittleEndian::readUint32(aPayload);
+  if (!aMessage.SetLength(messageSize, fallible))
+    return false;
+  int result = uncompress(reinterpret_cast<Bytef*>(aMessage.BeginWriting()), &messageSize,
+      reinterpret_cast<const Bytef*>(aPayload + 4), aSize - 4);
+  return result == Z_OK && messageSize == aMessage.Length();
+}
+
+#if defined(_WIN32)
+// Returns the number of write calls made.
+uint64_t WriteBytes(const char* bytes, size_t size)
 {
+    uint64_t calls = 0;
     size_t totalWritten = 0;
     while (totalWritten < size) {
         size_t length = size - totalWritten;
         if (length > kWritePacketSize)
             length = kWritePacketSize;
-#if defined(_WIN32)
         DWORD bytesWritten = 0;
         bool hadError = !WriteFile(writeHandle, bytes + totalWritten, static_cast<DWORD>(length), &bytesWritten, nullptr);
-#else
-        int bytesWritten = write(writeFD, bytes + totalWritten, length);
-        if (bytesWritten < 0 && errno == EINTR)
-            continue;
-        bool hadError = bytesWritten <= 0;
-#endif
+        ++calls;
         if (hadError)
-            return;
+            return calls;
         totalWritten += bytesWritten;
     }
+    return calls;
 }
+#endif
 
 }  // namespace
 
@@ -93,7 +163,10 @@ already_AddRefed<nsIRemoteDebuggingPipe> nsRemoteDebuggingPipe::GetSingleton() {
   return do_AddRef(gPipe);
 }
 
-nsRemoteDebuggingPipe::nsRemoteDebuggingPipe() = default;
+nsRemoteDebuggingPipe::nsRemoteDebuggingPipe()
+    : mIncomingLock("nsRemoteDebuggingPipe::mIncomingLock")
+    , mOutgoingLock("nsRemoteDebuggingPipe::mOutgoingLock") {
+}
 
 nsRemoteDebuggingPipe::~nsRemoteDebuggingPipe() = default;
 
@@ -104,6 +177,7 @@ nsresult nsRemoteDebuggingPipe::Init(nsIRemoteDebuggingPipeClient* aClient) {
   }
   mClient = aClient;
 
+  mStartTime = TimeStamp::Now();
   MOZ_ALWAYS_SUCCEEDS(NS_NewNamedThread("Pipe Reader", getter_AddRefs(mReaderThread)));
   MOZ_ALWAYS_SUCCEEDS(NS_NewNamedThread("Pipe Writer", getter_AddRefs(mWriterThread)));
 
@@ -116,6 +190,17 @@ nsresult nsRemoteDebuggingPipe::Init(nsIRemoteDebuggingPipeClient* aClient) {
   writeHandle = reinterpret_cast<HANDLE>(atoi(pipeWriteStr));
 #endif
 
+  const char* framing = PR_GetEnv("PW_PIPE_FRAMING");
+  const char* compression = PR_GetEnv("PW_PIPE_COMPRESSION");
+  mCompressFrames = compression && !strcmp(compression, "deflate");
+  mFramingRequested = mCompressFrames || (framing && !strcmp(framing, "binary"));
+  if (mFramingRequested) {
+    // The offer goes out before any message can be queued.
+    MOZ_ALWAYS_SUCCEEDS(mWriterThread->Dispatch(NewRunnableMethod(
+        "nsRemoteDebuggingPipe::WriteFramingHandshake",
+        this, &nsRemoteDebuggingPipe::WriteFramingHandshake), nsIThread::DISPATCH_NORMAL));
+  }
+
   MOZ_ALWAYS_SUCCEEDS(mReaderThread->Dispatch(NewRunnableMethod(
       "nsRemoteDebuggingPipe::ReaderLoop",
       this, &nsRemoteDebuggingPipe::ReaderLoop), nsIThread::DISPATCH_NORMAL));
@@ -129,6 +214,8 @@ nsresult nsRemoteDebuggingPipe::Stop() {
   }
   m_terminated = true;
   mClient = nullptr;
+  if (PR_GetEnv("PW_PIPE_STATS"))
+    DumpStats();
   // Cancel pending synchronous read.
 #if defined(_WIN32)
   CancelIoEx(readHandle, nullptr);
@@ -146,78 +233,395 @@ nsresult nsRemoteDebuggingPipe::Stop() {
 }
 
 void nsRemoteDebuggingPipe::ReaderLoop() {
-  const size_t bufSize = 256 * 1024;
-  std::vector<char> buffer;
-  buffer.resize(bufSize);
-  std::vector<char> line;
+  // Bytes are read straight into |buffer|. Messages are the '\0' terminated
+  // runs or the frames in [start, length), |scanned| is where the delimiter
+  // search resumes.
+  nsCString buffer;
+  size_t start = 0;
+  size_t scanned = 0;
+  size_t length = 0;
+  bool framed = false;
+  auto disconnect = [this] {
+    nsCOMPtr<nsIRunnable> runnable = NewRunnableMethod<>(
+        "nsRemoteDebuggingPipe::Disconnected",
+        this, &nsRemoteDebuggingPipe::Disconnected);
+    NS_DispatchToMainThread(runnable.forget());
+  };
   while (!m_terminated) {
-    size_t size = ReadBytes(buffer.data(), bufSize, false);
+    if (buffer.Length() - length < kReadSize) {
+      // Compact only when it frees at least half of the buffer, so every
+      // byte is moved a bounded number of times.
+      if (start && start * 2 >= length) {
+        memmove(buffer.BeginWriting(), buffer.BeginReading() + start, length - start);
+        length -= start;
+        scanned -= start;
+        start = 0;
+      }
+      if (buffer.Length() - length < kReadSize)
+        buffer.SetLength(std::max<size_t>(buffer.Length() * 2, length + kReadSize));
+    }
+    size_t size = ReadBytes(buffer.BeginWriting() + length, buffer.Length() - length, false);
     if (!size) {
-      nsCOMPtr<nsIRunnable> runnable = NewRunnableMethod<>(
-          "nsRemoteDebuggingPipe::Disconnected",
-          this, &nsRemoteDebuggingPipe::Disconnected);
-      NS_DispatchToMainThread(runnable.forget());
+      disconnect();
       break;
     }
-    size_t start = 0;
-    size_t end = line.size();
-    line.insert(line.end(), buffer.begin(), buffer.begin() + size);
-    while (true) {
-      for (; end < line.size(); ++end) {
-        if (line[end] == '\0') {
-          break;
-        }
-      }
-      if (end == line.size()) {
+    mBytesRead += size;
+    length += size;
+    // Messages from one read are handed to the main thread together.
+    nsTArray<nsCString> messages;
+    while (!framed) {
+      const char* delimiter = static_cast<const char*>(memchr(buffer.BeginReading() + scanned, '\0', length - scanned));
+      if (!delimiter)
         break;
-      }
+      size_t end = delimiter - buffer.BeginReading();
       if (end > start) {
         nsCString message;
-        message.Append(line.data() + start, end - start);
-        nsCOMPtr<nsIRunnable> runnable = NewRunnableMethod<nsCString>(
-            "nsRemoteDebuggingPipe::ReceiveMessage",
-            this, &nsRemoteDebuggingPipe::ReceiveMessage, std::move(message));
-        NS_DispatchToMainThread(runnable.forget());
+        if (!start && end * 2 >= buffer.Length()) {
+          // The message fills most of the buffer, hand the buffer over and
+          // copy the bytes after it instead. Its delimiter becomes the
+          // string terminator.
+          nsCString rest(Substring(buffer, end + 1, length - end - 1));
+          message = std::move(buffer);
+          message.SetLength(end);
+          buffer = std::move(rest);
+          length = buffer.Length();
+          start = scanned = 0;
+          messages.AppendElement(std::move(message));
+          continue;
+        }
+        message.Assign(buffer.BeginReading() + start, end - start);
+        // The driver took the offer, the rest of the input is frames and
+        // our output switches to frames as well.
+        if (mFramingRequested && message.EqualsLiteral(kFramingHandshake)) {
+          framed = true;
+          MOZ_ALWAYS_SUCCEEDS(mWriterThread->Dispatch(NewRunnableMethod(
+              "nsRemoteDebuggingPipe::StartFramedWrites",
+              this, &nsRemoteDebuggingPipe::StartFramedWrites), nsIThread::DISPATCH_NORMAL));
+        } else
+          messages.AppendElement(std::move(message));
       }
-      ++end;
-      start = end;
+      start = scanned = end + 1;
     }
-    if (start != 0 && start < line.size()) {
-      memmove(line.data(), line.data() + start, line.size() - start);
+    while (framed && length - start >= kFrameHeaderSize) {
+      uint32_t header = LittleEndian::readUint32(buffer.BeginReading() + start);
+      size_t payloadSize = header & kFrameSizeMask;
+      if (length - start - kFrameHeaderSize < payloadSize)
+        break;
+      if (header & kFrameAttachment) {
+        // The driver does not send attachments.
+        fprintf(stderr, "Unexpected attachment on the remote debugging pipe\n");
+        start += kFrameHeaderSize + payloadSize;
+        continue;
+      }
+      nsCString message;
+      if (!DecodeFrame(header, buffer.BeginReading() + start + kFrameHeaderSize, payloadSize, message)) {
+        fprintf(stderr, "Failed to decode remote debugging pipe frame\n");
+        // The stream cannot be resynchronized, treat it as closed.
+        if (!messages.IsEmpty())
+          EnqueueMessages(std::move(messages));
+        disconnect();
+        return;
+      }
+      messages.AppendElement(std::move(message));
+      start += kFrameHeaderSize + payloadSize;
     }
-    line.resize(line.size() - start);
+    if (!messages.IsEmpty())
+      EnqueueMessages(std::move(messages));
+    scanned = length;
+    // Everything consumed, reuse the buffer from the front.
+    if (start == length)
+      start = scanned = length = 0;
   }
 }
 
-void nsRemoteDebuggingPipe::ReceiveMessage(const nsCString& aMessage) {
+void nsRemoteDebuggingPipe::EnqueueMessages(nsTArray<nsCString>&& aMessages) {
+  TimeStamp now = TimeStamp::Now();
+  mMessagesRead += aMessages.Length();
+  for (const nsCString& message : aMessages)
+    mLargestMessageRead = std::max<uint32_t>(mLargestMessageRead, message.Length());
+  {
+    MutexAutoLock lock(mIncomingLock);
+    for (nsCString& message : aMessages)
+      mIncoming.push_back(IncomingMessage{ std::move(message), now });
+    // A pending delivery task picks up the new messages as well.
+    if (mDeliveryScheduled)
+      return;
+    mDeliveryScheduled = true;
+    mDeliveryScheduledTime = now;
+  }
+  NS_DispatchToMainThread(NewRunnableMethod(
+      "nsRemoteDebuggingPipe::ReceiveMessages",
+      this, &nsRemoteDebuggingPipe::ReceiveMessages));
+}
+
+void nsRemoteDebuggingPipe::ReceiveMessages() {
   MOZ_RELEASE_ASSERT(NS_IsMainThread(), "Remote debugging pipe must be used on the Main thread.");
-  if (mClient) {
-    NS_ConvertUTF8toUTF16 utf16(aMessage);
-    mClient->ReceiveMessage(utf16);
+  TimeStamp now = TimeStamp::Now();
+  {
+    MutexAutoLock lock(mIncomingLock);
+    mDispatchLatency.Add(now - mDeliveryScheduledTime);
+  }
+  // Yield to other main thread work between slices of a long burst, so that
+  // input handling and painting are not held up.
+  TimeStamp deadline = now + TimeDuration::FromMilliseconds(kMaxDeliveryMs);
+  while (ReceiveNextMessage()) {
+    if (TimeStamp::Now() >= deadline) {
+      {
+        MutexAutoLock lock(mIncomingLock);
+        mDeliveryScheduledTime = TimeStamp::Now();
+      }
+      NS_DispatchToMainThread(NewRunnableMethod(
+          "nsRemoteDebuggingPipe::ReceiveMessages",
+          this, &nsRemoteDebuggingPipe::ReceiveMessages));
+      return;
+    }
   }
 }
 
+bool nsRemoteDebuggingPipe::ReceiveNextMessage() {
+  IncomingMessage message;
+  {
+    MutexAutoLock lock(mIncomingLock);
+    if (mIncoming.empty()) {
+      mDeliveryScheduled = false;
+      return false;
+    }
+    message = std::move(mIncoming.front());
+    mIncoming.pop_front();
+  }
+  mWaitLatency.Add(TimeStamp::Now() - message.mReadTime);
+  if (mClient)
+    mClient->ReceiveMessage(message.mData);
+  return true;
+}
+
 void nsRemoteDebuggingPipe::Disconnected() {
   MOZ_RELEASE_ASSERT(NS_IsMainThread(), "Remote debugging pipe must be used on the Main thread.");
+  // Messages read before the disconnect still go first.
+  while (ReceiveNextMessage()) {
+  }
   if (mClient)
     mClient->Disconnected();
 }
 
-nsresult nsRemoteDebuggingPipe::SendMessage(const nsAString& aMessage) {
+nsresult nsRemoteDebuggingPipe::SendMessage(const nsACString& aMessage) {
+  return SendMessageWithAttachments(aMessage, nsTArray<nsCString>());
+}
+
+nsresult nsRemoteDebuggingPipe::SendMessageWithAttachments(const nsACString& aMessage, const nsTArray<nsCString>& aAttachments) {
   MOZ_RELEASE_ASSERT(NS_IsMainThread(), "Remote debugging pipe must be used on the Main thread.");
   if (!mClient) {
     return NS_ERROR_FAILURE;
   }
-  NS_ConvertUTF16toUTF8 utf8(aMessage);
-  nsCOMPtr<nsIRunnable> runnable = NS_NewRunnableFunction(
-      "nsRemoteDebuggingPipe::SendMessage",
-      [message = std::move(utf8)] {
-        const nsCString& flat = PromiseFlatCString(message);
-        WriteBytes(flat.Data(), flat.Length());
-        WriteBytes("\0", 1);
-      });
-  MOZ_ALWAYS_SUCCEEDS(mWriterThread->Dispatch(runnable.forget(), nsIThread::DISPATCH_NORMAL));
+  if (!aAttachments.IsEmpty() && !mFramedWrites) {
+    return NS_ERROR_NOT_AVAILABLE;
+  }
+  {
+    MutexAutoLock lock(mOutgoingLock);
+    for (const nsCString& attachment : aAttachments)
+      mOutgoing.AppendElement(OutgoingMessage{ attachment, true });
+    mOutgoing.AppendElement(OutgoingMessage{ nsCString(aMessage), false });
+    // The writer drains everything queued so far in one go, only wake it up
+    // when it is idle.
+    if (mFlushScheduled)
+      return NS_OK;
+    mFlushScheduled = true;
+  }
+  MOZ_ALWAYS_SUCCEEDS(mWriterThread->Dispatch(NewRunnableMethod(
+      "nsRemoteDebuggingPipe::FlushOutgoing",
+      this, &nsRemoteDebuggingPipe::FlushOutgoing), nsIThread::DISPATCH_NORMAL));
   return NS_OK;
 }
 
+void nsRemoteDebuggingPipe::FlushOutgoing() {
+  while (true) {
+    nsTArray<OutgoingMessage> queued;
+    {
+      MutexAutoLock lock(mOutgoingLock);
+      if (mOutgoing.IsEmpty()) {
+        mFlushScheduled = false;
+        return;
+      }
+      queued = std::move(mOutgoing);
+    }
+    mMaxQueueDepth = std::max<uint32_t>(mMaxQueueDepth, queued.Length());
+    mMessagesWritten += queued.Length();
+    nsTArray<nsCString> messages(queued.Length());
+    for (OutgoingMessage& message : queued) {
+      mLargestMessageWritten = std::max<uint32_t>(mLargestMessageWritten, message.mData.Length());
+      if (mFramedWrites)
+        EncodeFrame(message.mData, message.mAttachment, mCompressFrames, *messages.AppendElement());
+      else
+        messages.AppendElement(std::move(message.mData));
+    }
+    WriteMessages(messages, !mFramedWrites);
+  }
+}
+
+void nsRemoteDebuggingPipe::WriteFramingHandshake() {
+  nsTArray<nsCString> handshake;
+  handshake.AppendElement(nsLiteralCString(kFramingHandshake));
+  WriteMessages(handshake, true);
+}
+
+void nsRemoteDebuggingPipe::StartFramedWrites() {
+  WriteFramingHandshake();
+  mFramedWrites = true;
+}
+
+// Writes the messages, with terminators unless they are frames, using as few
+// syscalls as possible.
+void nsRemoteDebuggingPipe::WriteMessages(const nsTArray<nsCString>& aMessages, bool aTerminate) {
+#if defined(_WIN32)
+  // No scatter-gather writes on pipes, coalesce into one buffer instead.
+  nsCString buffer;
+  for (const nsCString& message : aMessages) {
+    buffer.Append(message);
+    if (aTerminate)
+      buffer.Append('\0');
+  }
+  mWriteCalls += WriteBytes(buffer.Data(), buffer.Length());
+  mBytesWritten += buffer.Length();
+#else
+  static const char kTerminator = '\0';
+  std::vector<iovec> buffers;
+  buffers.reserve(aMessages.Length() * 2);
+  for (const nsCString& message : aMessages) {
+    buffers.push_back({ const_cast<char*>(message.BeginReading()), message.Length() });
+    if (aTerminate)
+      buffers.push_back({ const_cast<char*>(&kTerminator), 1 });
+  }
+  size_t index = 0;
+  while (index < buffers.size()) {
+    int count = static_cast<int>(std::min<size_t>(buffers.size() - index, IOV_MAX));
+    ssize_t written = writev(writeFD, buffers.data() + index, count);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return;
+    ++mWriteCalls;
+    mBytesWritten += written;
+    // Skip what has been written, the last buffer may be written partially.
+    size_t remaining = written;
+    while (index < buffers.size() && remaining >= buffers[index].iov_len) {
+      remaining -= buffers[index].iov_len;
+      ++index;
+    }
+    if (remaining) {
+      buffers[index].iov_base = static_cast<char*>(buffers[index].iov_base) + remaining;
+      buffers[index].iov_len -= remaining;
+    }
+  }
+#endif
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetBinaryAttachments(bool* aBinaryAttachments) {
+  *aBinaryAttachments = mFramedWrites;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetMessagesWritten(uint64_t* aMessagesWritten) {
+  *aMessagesWritten = mMessagesWritten;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetBytesWritten(uint64_t* aBytesWritten) {
+  *aBytesWritten = mBytesWritten;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetWriteCalls(uint64_t* aWriteCalls) {
+  *aWriteCalls = mWriteCalls;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetMaxQueueDepth(uint32_t* aMaxQueueDepth) {
+  *aMaxQueueDepth = mMaxQueueDepth;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetQueueDepth(uint32_t* aQueueDepth) {
+  MutexAutoLock lock(mOutgoingLock);
+  *aQueueDepth = mOutgoing.Length();
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetLargestMessageWritten(uint32_t* aLargestMessageWritten) {
+  *aLargestMessageWritten = mLargestMessageWritten;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetMessagesRead(uint64_t* aMessagesRead) {
+  *aMessagesRead = mMessagesRead;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetBytesRead(uint64_t* aBytesRead) {
+  *aBytesRead = mBytesRead;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetLargestMessageRead(uint32_t* aLargestMessageRead) {
+  *aLargestMessageRead = mLargestMessageRead;
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetElapsedSeconds(double* aElapsedSeconds) {
+  *aElapsedSeconds = mStartTime.IsNull() ? 0 : (TimeStamp::Now() - mStartTime).ToSeconds();
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetLatencyBucketBoundsMs(nsTArray<double>& aBounds) {
+  double bound = kFirstLatencyBucketMs;
+  for (size_t i = 0; i + 1 < kLatencyBuckets; ++i, bound *= 2)
+    aBounds.AppendElement(bound);
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetDispatchLatency(nsTArray<uint64_t>& aCounts) {
+  aCounts = mDispatchLatency.Counts();
+  return NS_OK;
+}
+
+NS_IMETHODIMP nsRemoteDebuggingPipe::GetWaitLatency(nsTArray<uint64_t>& aCounts) {
+  aCounts = mWaitLatency.Counts();
+  return NS_OK;
+}
+
+void nsRemoteDebuggingPipe::DumpStats() {
+  double elapsed = std::max((TimeStamp::Now() - mStartTime).ToSeconds(), 1e-3);
+  fprintf(stderr, "Pipe read: %" PRIu64 " messages, %" PRIu64 " bytes (%.0f bytes/s), largest %u bytes\n",
+      uint64_t(mMessagesRead), uint64_t(mBytesRead), mBytesRead / elapsed, uint32_t(mLargestMessageRead));
+  fprintf(stderr, "Pipe written: %" PRIu64 " messages, %" PRIu64 " bytes (%.0f bytes/s), largest %u bytes, %" PRIu64 " writes, max queue depth %u\n",
+      uint64_t(mMessagesWritten), uint64_t(mBytesWritten), mBytesWritten / elapsed, uint32_t(mLargestMessageWritten), uint64_t(mWriteCalls), uint32_t(mMaxQueueDepth));
+  auto dump = [](const char* aName, const nsTArray<uint64_t>& aCounts) {
+    fprintf(stderr, "Pipe %s:", aName);
+    double bound = kFirstLatencyBucketMs;
+    for (size_t i = 0; i < aCounts.Length(); ++i, bound *= 2) {
+      if (i + 1 < aCounts.Length())
+        fprintf(stderr, " <%gms: %" PRIu64, bound, aCounts[i]);
+      else
+        fprintf(stderr, " slower: %" PRIu64 "\n", aCounts[i]);
+    }
+  };
+  dump("dispatch latency", mDispatchLatency.Counts());
+  dump("wait before dispatch", mWaitLatency.Counts());
+}
+
+void nsRemoteDebuggingPipe::LatencyHistogram::Add(TimeDuration aLatency) {
+  double ms = aLatency.ToMilliseconds();
+  double bound = kFirstLatencyBucketMs;
+  size_t bucket = 0;
+  for (; bucket + 1 < kLatencyBuckets && ms >= bound; ++bucket)
+    bound *= 2;
+  ++mCounts[bucket];
+}
+
+nsTArray<uint64_t> nsRemoteDebuggingPipe::LatencyHistogram::Counts() const {
+  nsTArray<uint64_t> counts(kLatencyBuckets);
+  for (const auto& count : mCounts)
+    counts.AppendElement(count);
+  return counts;
+}
+
 }  // namespace mozilla
@@ -4,9 +4,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <memory>
+#include "mozilla/Mutex.h"
+#include "mozilla/TimeStamp.h"
 #include "nsCOMPtr.h"
 #include "nsIRemoteDebuggingPipe.h"
+#include "nsTArray.h"
 #include "nsThread.h"
 
 namespace mozilla {
@@ -19,16 +24,82 @@ class nsRemoteDebuggingPipe final : public nsIRemoteDebuggingPipe {
   static already_AddRefed<nsIRemoteDebuggingPipe> GetSingleton();
   nsRemoteDebuggingPipe();
 
+  // Latency buckets are bounded by 0.25ms, doubling up to 128ms, the last
+  // one counts everything slower.
+  static constexpr size_t kLatencyBuckets = 11;
+
  private:
+  // Lock-free counts of latencies per bucket.
+  class LatencyHistogram {
+   public:
+    void Add(TimeDuration aLatency);
+    nsTArray<uint64_t> Counts() const;
+
+   private:
+    std::atomic<uint64_t> mCounts[kLatencyBuckets] = {};
+  };
+
+  struct IncomingMessage {
+    nsCString mData;
+    TimeStamp mReadTime;
+  };
+
   void ReaderLoop();
-  void ReceiveMessage(const nsCString& aMessage);
+  void WriteFramingHandshake();
+  void StartFramedWrites();
+  void FlushOutgoing();
+  void WriteMessages(const nsTArray<nsCString>& aMessages, bool aTerminate);
+  void EnqueueMessages(nsTArray<nsCString>&& aMessages);
+  void ReceiveMessages();
+  bool ReceiveNextMessage();
   void Disconnected();
+  void DumpStats();
   ~nsRemoteDebuggingPipe();
 
   RefPtr<nsIRemoteDebuggingPipeClient> mClient;
   nsCOMPtr<nsIThread> mReaderThread;
   nsCOMPtr<nsIThread> mWriterThread;
   std::atomic<bool> m_terminated { false };
+  // Set in Init() from the driver's framing options.
+  bool mFramingRequested = false;
+  bool mCompressFrames = false;
+  // Set on the writer thread once the driver has taken the offer and the
+  // switch to frames has been announced, read from anywhere.
+  std::atomic<bool> mFramedWrites { false };
+
+  // Messages waiting for the main thread.
+  Mutex mIncomingLock;
+  std::deque<IncomingMessage> mIncoming MOZ_GUARDED_BY(mIncomingLock);
+  bool mDeliveryScheduled MOZ_GUARDED_BY(mIncomingLock) = false;
+  TimeStamp mDeliveryScheduledTime MOZ_GUARDED_BY(mIncomingLock);
+
+  // Messages waiting for the writer thread.
+  struct OutgoingMessage {
+    nsCString mData;
+    bool mAttachment = false;
+  };
+  Mutex mOutgoingLock;
+  nsTArray<OutgoingMessage> mOutgoing MOZ_GUARDED_BY(mOutgoingLock);
+  bool mFlushScheduled MOZ_GUARDED_BY(mOutgoingLock) = false;
+
+  // Written on the reader thread, read from anywhere.
+  std::atomic<uint64_t> mMessagesRead { 0 };
+  std::atomic<uint64_t> mBytesRead { 0 };
+  std::atomic<uint32_t> mLargestMessageRead { 0 };
+
+  // Written on the writer thread, read from anywhere.
+  std::atomic<uint64_t> mMessagesWritten { 0 };
+  std::atomic<uint64_t> mBytesWritten { 0 };
+  std::atomic<uint64_t> mWriteCalls { 0 };
+  std::atomic<uint32_t> mMaxQueueDepth { 0 };
+  std::atomic<uint32_t> mLargestMessageWritten { 0 };
+
+  // Main thread only.
+  TimeStamp mStartTime;
+  // Time from scheduling a delivery task to it running.
+  LatencyHistogram mDispatchLatency;
+  // Time from reading a message to handing it to the client.
+  LatencyHistogram mWaitLatency;
 };
 
 }  // namespace mozilla
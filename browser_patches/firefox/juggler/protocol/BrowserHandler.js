@@ -295,6 +295,31 @@ export class BrowserHandler {
                                 .userAgent;
     return {version: 'Firefox/' + version, userAgent};
   }
+
+  ['Browser.getTransportStats']() {
+    const pipe = Cc['@mozilla.org/juggler/remotedebuggingpipe;1'].getService(Ci.nsIRemoteDebuggingPipe);
+    const elapsedSeconds = pipe.elapsedSeconds;
+    const perSecond = value => elapsedSeconds ? value / elapsedSeconds : 0;
+    return {
+      stats: {
+        elapsedSeconds,
+        messagesRead: pipe.messagesRead,
+        bytesRead: pipe.bytesRead,
+        bytesReadPerSecond: perSecond(pipe.bytesRead),
+        largestMessageRead: pipe.largestMessageRead,
+        messagesWritten: pipe.messagesWritten,
+        bytesWritten: pipe.bytesWritten,
+        bytesWrittenPerSecond: perSecond(pipe.bytesWritten),
+        largestMessageWritten: pipe.largestMessageWritten,
+        writeCalls: pipe.writeCalls,
+        queueDepth: pipe.queueDepth,
+        maxQueueDepth: pipe.maxQueueDepth,
+        latencyBucketBoundsMs: pipe.latencyBucketBoundsMs,
+        dispatchLatency: pipe.dispatchLatency,
+        waitLatency: pipe.waitLatency,
+      },
+    };
+  }
 }
 
 async function waitForWindowClosed(browserWindow) {
@@ -3,7 +3,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 const {protocol} = ChromeUtils.importESModule("chrome://juggler/content/protocol/Protocol.js");
-const {checkScheme} = ChromeUtils.importESModule("chrome://juggler/content/protocol/PrimitiveTypes.js");
+const {Binary, checkScheme} = ChromeUtils.importESModule("chrome://juggler/content/protocol/PrimitiveTypes.js");
 const {Helper} = ChromeUtils.importESModule('chrome://juggler/content/Helper.js');
 
 const helper = new Helper();
@@ -73,15 +73,15 @@ export class Dispatcher {
       if ((descriptor.returns || result) && !checkScheme(descriptor.returns, result, details))
         throw new Error(`ERROR: failed to dispatch method '${method}' result ${JSON.stringify(result, null, 2)}\n${details.error}`);
 
-      this._connection.send(JSON.stringify({id, sessionId, result}));
+      this._send({id, sessionId, result});
     } catch (e) {
       dump(`
         ERROR: ${e.message} ${e.stack}
       `);
-      this._connection.send(JSON.stringify({id, sessionId, error: {
+      this._send({id, sessionId, error: {
         message: e.message,
         data: e.stack
-      }}));
+      }});
     }
   }
 
@@ -93,7 +93,19 @@ export class Dispatcher {
     const details = {};
     if (!checkScheme(scheme, params || {}, details))
       throw new Error(`ERROR: failed to emit event '${eventName}' ${JSON.stringify(params, null, 2)}\n${details.error}`);
-    this._connection.send(JSON.stringify({method: eventName, params, sessionId}));
+    this._send({method: eventName, params, sessionId});
+  }
+
+  _send(message) {
+    const attachments = [];
+    Binary.attachments = this._connection.binaryAttachments ? attachments : null;
+    let json;
+    try {
+      json = JSON.stringify(message);
+    } finally {
+      Binary.attachments = null;
+    }
+    this._connection.send(json, attachments);
   }
 }
 
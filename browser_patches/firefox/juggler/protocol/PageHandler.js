@@ -103,6 +103,7 @@ export class PageHandler {
         this._session.emitEvent('Page.crashed', {});
       }),
       helper.on(this._pageTarget, PageTarget.Events.ScreencastFrame, this._onScreencastFrame.bind(this)),
+      helper.on(this._pageTarget, PageTarget.Events.ScreencastTiles, this._onScreencastTiles.bind(this)),
       helper.on(this._pageNetwork, PageNetwork.Events.Request, this._handleNetworkEvent.bind(this, 'Network.requestWillBeSent')),
       helper.on(this._pageNetwork, PageNetwork.Events.Response, this._handleNetworkEvent.bind(this, 'Network.responseReceived')),
       helper.on(this._pageNetwork, PageNetwork.Events.RequestFinished, this._handleNetworkEvent.bind(this, 'Network.requestFinished')),
@@ -159,6 +160,10 @@ export class PageHandler {
     this._session.emitEvent('Page.screencastFrame', params);
   }
 
+  _onScreencastTiles(params) {
+    this._session.emitEvent('Page.screencastTiles', params);
+  }
+
   _onPageReady(event) {
     this._isPageReady = true;
     this._session.emitEvent('Page.ready');
@@ -678,6 +683,18 @@ export class PageHandler {
     await this._pageTarget.stopScreencast(options);
   }
 
+  async ['Page.getScreencastStats']() {
+    return { stats: this._pageTarget.screencastStats() };
+  }
+
+  async ['Page.startVideoRecording'](options) {
+    await this._pageTarget.startVideoRecording(options);
+  }
+
+  async ['Page.stopVideoRecording']() {
+    await this._pageTarget.stopVideoRecording();
+  }
+
   async ['Page.sendMessageToWorker']({workerId, message}) {
     const worker = this._workers.get(workerId);
     if (!worker)
@@ -11,6 +11,31 @@ t.String = function(x, details = {}, path = ['<root>']) {
   return false;
 }
 
+// Bytes held in a byte string. Serialized as a pipe attachment when the
+// connection supports them, as Base64 otherwise.
+export class Binary {
+  constructor(bytes) {
+    this.bytes = bytes;
+  }
+
+  toJSON() {
+    if (!Binary.attachments)
+      return btoa(this.bytes);
+    Binary.attachments.push(this.bytes);
+    return { $binary: Binary.attachments.length - 1 };
+  }
+}
+
+// Collects attachments while the dispatcher serializes a message.
+Binary.attachments = null;
+
+t.Binary = function(x, details = {}, path = ['<root>']) {
+  if (typeof x === 'string' || x instanceof Binary)
+    return true;
+  details.error = `Expected "${path.join('.')}" to be |binary|; found |${typeof x}| instead.`;
+  return false;
+}
+
 t.Number = function(x, details = {}, path = ['<root>']) {
   if (typeof x === 'number')
     return true;
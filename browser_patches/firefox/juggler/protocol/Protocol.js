@@ -51,6 +51,27 @@ browserTypes.Geolocation = {
   accuracy: t.Optional(t.Number),
 };
 
+browserTypes.TransportStats = {
+  elapsedSeconds: t.Number,
+  messagesRead: t.Number,
+  bytesRead: t.Number,
+  bytesReadPerSecond: t.Number,
+  largestMessageRead: t.Number,
+  messagesWritten: t.Number,
+  bytesWritten: t.Number,
+  bytesWrittenPerSecond: t.Number,
+  largestMessageWritten: t.Number,
+  writeCalls: t.Number,
+  queueDepth: t.Number,
+  maxQueueDepth: t.Number,
+  // Upper bounds of the histogram buckets, the last bucket has none.
+  latencyBucketBoundsMs: t.Array(t.Number),
+  // Time from scheduling delivery of incoming messages to it starting.
+  dispatchLatency: t.Array(t.Number),
+  // Time from reading a message off the pipe to dispatching it.
+  waitLatency: t.Array(t.Number),
+};
+
 browserTypes.DownloadOptions = {
   behavior: t.Optional(t.Enum(['saveToDisk', 'cancel'])),
   downloadsDir: t.Optional(t.String),
@@ -104,6 +125,26 @@ pageTypes.Clip = {
   height: t.Number,
 };
 
+pageTypes.ScreencastTile = {
+  x: t.Number,
+  y: t.Number,
+  width: t.Number,
+  height: t.Number,
+  data: t.Binary,
+};
+
+pageTypes.ScreencastStats = {
+  framesEncoded: t.Number,
+  framesDropped: t.Number,
+  meanLatencyMs: t.Number,
+  maxLatencyMs: t.Number,
+  meanEncodeMs: t.Number,
+  // Buffer allocations made by the encoder, stays flat in steady state.
+  heapAllocations: t.Number,
+  ackLatencyMs: t.Number,
+  frameIntervalMs: t.Number,
+};
+
 pageTypes.InitScript = {
   script: t.String,
   worldName: t.Optional(t.String),
@@ -242,6 +283,11 @@ const Browser = {
         version: t.String,
       },
     },
+    'getTransportStats': {
+      returns: {
+        stats: browserTypes.TransportStats,
+      },
+    },
     'setExtraHTTPHeaders': {
       params: {
         browserContextId: t.Optional(t.String),
@@ -436,6 +482,9 @@ const Browser = {
           width: t.Number,
           height: t.Number,
           quality: t.Number,
+          fps: t.Optional(t.Number),
+          maxFramesInFlight: t.Optional(t.Number),
+          partialFrames: t.Optional(t.Boolean),
         }),
       },
     },
@@ -541,7 +590,7 @@ const Network = {
         requestId: t.String,
       },
       returns: {
-        base64body: t.String,
+        base64body: t.Binary,
         evicted: t.Optional(t.Boolean),
       },
     },
@@ -728,7 +777,14 @@ const Page = {
       timestamp: t.Number,
     },
     'screencastFrame': {
-      data: t.String,
+      data: t.Binary,
+      deviceWidth: t.Number,
+      deviceHeight: t.Number,
+      timestamp: t.Number,
+    },
+    // Changed areas of the last screencastFrame, only sent with partialFrames.
+    'screencastTiles': {
+      tiles: t.Array(pageTypes.ScreencastTile),
       deviceWidth: t.Number,
       deviceHeight: t.Number,
       timestamp: t.Number,
@@ -947,12 +1003,36 @@ const Page = {
         width: t.Number,
         height: t.Number,
         quality: t.Number,
+        // Target capture rate, 25 by default. Slow consumers get fewer frames.
+        fps: t.Optional(t.Number),
+        // Number of unacknowledged frames the browser may send, 1 by default.
+        maxFramesInFlight: t.Optional(t.Number),
+        // Send changed tiles between periodic key frames, see screencastTiles.
+        partialFrames: t.Optional(t.Boolean),
       },
     },
     'screencastFrameAck': {
     },
     'stopScreencast': {
     },
+    'getScreencastStats': {
+      returns: {
+        stats: pageTypes.ScreencastStats,
+      },
+    },
+    // Records the page into a VP8 IVF video file, encoded in the browser.
+    'startVideoRecording': {
+      params: {
+        file: t.String,
+        width: t.Number,
+        height: t.Number,
+        // Target capture rate, 25 by default.
+        fps: t.Optional(t.Number),
+      },
+    },
+    // Resolves once the video file is complete.
+    'stopVideoRecording': {
+    },
   },
 };
 
@@ -48,16 +48,14 @@ void HeadlessWindowCapturer::DeRegisterCaptureDataCallback() {
 }
 
 void HeadlessWindowCapturer::RegisterRawFrameCallback(webrtc::RawFrameCallback* rawFrameCallback) {
-  webrtc::CritScope lock2(&_callBackCs);
-  _rawFrameCallbacks.insert(rawFrameCallback);
+  _rawFrameCallbacks.Add(rawFrameCallback);
+  // Snapshots are only taken when something is painted, make sure the new
+  // callback gets the current content.
+  mWindow->ForceSnapshot();
 }
 
 void HeadlessWindowCapturer::DeRegisterRawFrameCallback(webrtc::RawFrameCallback* rawFrameCallback) {
-  webrtc::CritScope lock2(&_callBackCs);
-  auto it = _rawFrameCallbacks.find(rawFrameCallback);
-  if (it != _rawFrameCallbacks.end()) {
-    _rawFrameCallbacks.erase(it);
-  }
+  _rawFrameCallbacks.Remove(rawFrameCallback);
 }
 
 void HeadlessWindowCapturer::NotifyFrameCaptured(const webrtc::VideoFrame& frame) {
@@ -67,7 +65,9 @@ void HeadlessWindowCapturer::NotifyFrameCaptured(const webrtc::VideoFrame& frame
 }
 
 int32_t HeadlessWindowCapturer::StartCapture(const webrtc::VideoCaptureCapability& capability) {
-  mWindow->SetSnapshotListener([this] (RefPtr<gfx::DataSourceSurface>&& dataSurface){
+  if (capability.maxFPS > 0)
+    mWindow->SetSnapshotInterval(1000 / capability.maxFPS);
+  mWindow->SetSnapshotListener([this] (RefPtr<gfx::DataSourceSurface>&& dataSurface, const gfx::IntRect& dirtyRect){
     if (!NS_IsInCompositorThread()) {
       fprintf(stderr, "SnapshotListener is called not on the Compositor thread!\n");
       return;
@@ -78,6 +78,14 @@ int32_t HeadlessWindowCapturer::StartCapture(const webrtc::VideoCaptureCapabilit
       return;
     }
 
+    // The surface wraps the compositor's pixels, map it once and let all
+    // consumers read it in place.
+    gfx::DataSourceSurface::ScopedMap map(dataSurface.get(), gfx::DataSourceSurface::MapType::READ);
+    if (!map.IsMapped()) {
+      fprintf(stderr, "Failed to map snapshot bytes!\n");
+      return;
+    }
+
     webrtc::VideoCaptureCapability frameInfo;
     frameInfo.width = dataSurface->GetSize().width;
     frameInfo.height = dataSurface->GetSize().height;
@@ -87,11 +95,13 @@ int32_t HeadlessWindowCapturer::StartCapture(const webrtc::VideoCaptureCapabilit
       frameInfo.videoType = VideoType::kBGRA;
     }
 
+    webrtc::DesktopRect damage = webrtc::DesktopRect::MakeXYWH(dirtyRect.X(), dirtyRect.Y(), dirtyRect.Width(), dirtyRect.Height());
+    _rawFrameCallbacks.ForEach([&](webrtc::RawFrameCallback* rawFrameCallback) {
+      rawFrameCallback->OnRawFrame(map.GetData(), map.GetStride(), frameInfo, damage);
+    });
+
     {
       webrtc::CritScope lock2(&_callBackCs);
-      for (auto rawFrameCallback : _rawFrameCallbacks) {
-        rawFrameCallback->OnRawFrame(dataSurface->GetData(), dataSurface->Stride(), frameInfo);
-      }
       if (!_dataCallBacks.size())
         return;
     }
@@ -100,12 +110,6 @@ int32_t HeadlessWindowCapturer::StartCapture(const webrtc::VideoCaptureCapabilit
     int height = dataSurface->GetSize().height;
     webrtc::scoped_refptr<I420Buffer> buffer = I420Buffer::Create(width, height);
 
-    gfx::DataSourceSurface::ScopedMap map(dataSurface.get(), gfx::DataSourceSurface::MapType::READ);
-    if (!map.IsMapped()) {
-      fprintf(stderr, "Failed to map snapshot bytes!\n");
-      return;
-    }
-
     const int conversionResult = std::endian::native == std::endian::little ? libyuv::ARGBToI420(
       map.GetData(), map.GetStride(),
       buffer->MutableDataY(), buffer->StrideY(),
@@ -57,7 +57,7 @@ class HeadlessWindowCapturer : public webrtc::VideoCaptureModuleEx {
   RefPtr<mozilla::widget::HeadlessWidget> mWindow;
   webrtc::RecursiveCriticalSection _callBackCs;
   std::set<webrtc::VideoSinkInterface<webrtc::VideoFrame>*> _dataCallBacks;
-  std::set<webrtc::RawFrameCallback*> _rawFrameCallbacks;
+  webrtc::RawFrameCallbackList _rawFrameCallbacks;
 };
 
 }  // namespace mozilla
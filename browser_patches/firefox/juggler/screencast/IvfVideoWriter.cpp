@@ -0,0 +1,195 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "IvfVideoWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mozilla/EndianUtils.h"
+#include "vpx/vp8cx.h"
+
+#include <libyuv.h>
+
+namespace mozilla {
+
+namespace {
+
+const size_t kFileHeaderSize = 32;
+const size_t kFrameHeaderSize = 12;
+// Timestamps are in milliseconds.
+const int kTimebase = 1000;
+// Same encoding settings as the driver uses with ffmpeg: constant quality,
+// realtime deadline, one thread.
+const unsigned int kTargetBitrateKbps = 1000;
+const unsigned int kMaxQuantizer = 50;
+const int kCqLevel = 8;
+const int kCpuUsed = 8;
+// Gray padding for images smaller than the video.
+const int kPaddingY = 128;
+const int kPaddingUV = 128;
+
+}  // namespace
+
+// static
+UniquePtr<IvfVideoWriter> IvfVideoWriter::Create(const nsACString& path, int width, int height, uint32_t fps) {
+  FILE* file = fopen(PromiseFlatCString(path).get(), "wb");
+  if (!file) {
+    fprintf(stderr, "Failed to open video file %s\n", PromiseFlatCString(path).get());
+    return nullptr;
+  }
+  UniquePtr<IvfVideoWriter> writer(new IvfVideoWriter(file, width, height, fps));
+  if (!writer->Init())
+    return nullptr;
+  return writer;
+}
+
+IvfVideoWriter::IvfVideoWriter(FILE* file, int width, int height, uint32_t fps)
+    : mFile(file)
+    , mWidth(width)
+    , mHeight(height)
+    , mFps(fps) {
+}
+
+IvfVideoWriter::~IvfVideoWriter() {
+  if (mCodecInitialized)
+    vpx_codec_destroy(&mCodec);
+  if (mImage)
+    vpx_img_free(mImage);
+  if (mFile)
+    fclose(mFile);
+}
+
+bool IvfVideoWriter::Init() {
+  vpx_codec_enc_cfg_t config;
+  if (vpx_codec_enc_config_default(vpx_codec_vp8_cx(), &config, 0)) {
+    fprintf(stderr, "Failed to get default VP8 encoder config\n");
+    return false;
+  }
+  config.g_w = mWidth;
+  config.g_h = mHeight;
+  config.g_timebase.num = 1;
+  config.g_timebase.den = kTimebase;
+  config.g_threads = 1;
+  config.g_lag_in_frames = 0;
+  config.rc_end_usage = VPX_CQ;
+  config.rc_target_bitrate = kTargetBitrateKbps;
+  config.rc_min_quantizer = 0;
+  config.rc_max_quantizer = kMaxQuantizer;
+  if (vpx_codec_enc_init(&mCodec, vpx_codec_vp8_cx(), &config, 0)) {
+    fprintf(stderr, "Failed to initialize VP8 encoder: %s\n", vpx_codec_error(&mCodec));
+    return false;
+  }
+  mCodecInitialized = true;
+  vpx_codec_control(&mCodec, VP8E_SET_CQ_LEVEL, kCqLevel);
+  vpx_codec_control(&mCodec, VP8E_SET_CPUUSED, kCpuUsed);
+
+  mImage = vpx_img_alloc(nullptr, VPX_IMG_FMT_I420, mWidth, mHeight, 1);
+  if (!mImage) {
+    fprintf(stderr, "Failed to allocate video frame\n");
+    return false;
+  }
+  return WriteFileHeader();
+}
+
+bool IvfVideoWriter::WriteFileHeader() {
+  uint8_t header[kFileHeaderSize] = { 'D', 'K', 'I', 'F' };
+  LittleEndian::writeUint16(header + 4, 0);  // version
+  LittleEndian::writeUint16(header + 6, kFileHeaderSize);
+  memcpy(header + 8, "VP80", 4);
+  LittleEndian::writeUint16(header + 12, mWidth);
+  LittleEndian::writeUint16(header + 14, mHeight);
+  LittleEndian::writeUint32(header + 16, kTimebase);
+  LittleEndian::writeUint32(header + 20, 1);
+  LittleEndian::writeUint32(header + 24, mFrameCount);
+  if (fseek(mFile, 0, SEEK_SET) || fwrite(header, sizeof(header), 1, mFile) != 1) {
+    fprintf(stderr, "Failed to write video file header\n");
+    return false;
+  }
+  return true;
+}
+
+bool IvfVideoWriter::WriteFrame(const uint8_t* pixels, int stride, uint32_t fourcc, int width, int height, double timestamp) {
+  width = std::min(width, mWidth);
+  height = std::min(height, mHeight);
+  uint8_t* y = mImage->planes[VPX_PLANE_Y];
+  uint8_t* u = mImage->planes[VPX_PLANE_U];
+  uint8_t* v = mImage->planes[VPX_PLANE_V];
+  int strideY = mImage->stride[VPX_PLANE_Y];
+  int strideU = mImage->stride[VPX_PLANE_U];
+  int strideV = mImage->stride[VPX_PLANE_V];
+  if (width < mWidth || height < mHeight)
+    libyuv::I420Rect(y, strideY, u, strideU, v, strideV, 0, 0, mWidth, mHeight, kPaddingY, kPaddingUV, kPaddingUV);
+  int result = fourcc == libyuv::FOURCC_BGRA
+      ? libyuv::BGRAToI420(pixels, stride, y, strideY, u, strideU, v, strideV, width, height)
+      : libyuv::ARGBToI420(pixels, stride, y, strideY, u, strideU, v, strideV, width, height);
+  if (result) {
+    fprintf(stderr, "Failed to convert video frame to I420: %d\n", result);
+    return false;
+  }
+
+  if (mFirstTimestamp < 0)
+    mFirstTimestamp = timestamp;
+  return Encode(static_cast<int64_t>((timestamp - mFirstTimestamp) * kTimebase));
+}
+
+bool IvfVideoWriter::Encode(int64_t pts) {
+  // The encoder requires strictly increasing timestamps.
+  pts = std::max(pts, mLastPts + 1);
+  unsigned long duration = std::max<unsigned long>(1, kTimebase / mFps);
+  if (vpx_codec_encode(&mCodec, mImage, pts, duration, 0, VPX_DL_REALTIME)) {
+    fprintf(stderr, "Failed to encode video frame: %s\n", vpx_codec_error(&mCodec));
+    return false;
+  }
+  mLastPts = pts;
+  return WritePackets() >= 0;
+}
+
+bool IvfVideoWriter::Flush() {
+  // Encoding a null image drains whatever the encoder still holds.
+  while (true) {
+    if (vpx_codec_encode(&mCodec, nullptr, -1, 0, 0, VPX_DL_REALTIME)) {
+      fprintf(stderr, "Failed to flush video encoder: %s\n", vpx_codec_error(&mCodec));
+      return false;
+    }
+    int written = WritePackets();
+    if (written < 0)
+      return false;
+    if (!written)
+      return true;
+  }
+}
+
+int IvfVideoWriter::WritePackets() {
+  int written = 0;
+  vpx_codec_iter_t iter = nullptr;
+  while (const vpx_codec_cx_pkt_t* packet = vpx_codec_get_cx_data(&mCodec, &iter)) {
+    if (packet->kind != VPX_CODEC_CX_FRAME_PKT)
+      continue;
+    uint8_t header[kFrameHeaderSize];
+    LittleEndian::writeUint32(header, packet->data.frame.sz);
+    LittleEndian::writeUint64(header + 4, packet->data.frame.pts);
+    if (fwrite(header, sizeof(header), 1, mFile) != 1 ||
+        fwrite(packet->data.frame.buf, packet->data.frame.sz, 1, mFile) != 1) {
+      fprintf(stderr, "Failed to write video frame\n");
+      return -1;
+    }
+    ++mFrameCount;
+    ++written;
+  }
+  return written;
+}
+
+void IvfVideoWriter::Finish(double timestamp) {
+  // Pages that stopped painting would otherwise end the video early.
+  if (mFirstTimestamp >= 0)
+    Encode(static_cast<int64_t>((timestamp - mFirstTimestamp) * kTimebase));
+  if (mCodecInitialized)
+    Flush();
+  WriteFileHeader();
+  fclose(mFile);
+  mFile = nullptr;
+}
+
+}  // namespace mozilla
@@ -0,0 +1,54 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include <cstdio>
+#include "mozilla/UniquePtr.h"
+#include "nsString.h"
+#include "vpx/vpx_encoder.h"
+
+namespace mozilla {
+
+// Encodes frames with VP8 and appends them to an IVF file as they come, so
+// that a recording never has to be held in memory or sent anywhere. Not
+// thread-safe, callers must serialize calls.
+class IvfVideoWriter {
+ public:
+  // Opens |path| for writing, every frame of the video is |width|x|height|.
+  static UniquePtr<IvfVideoWriter> Create(const nsACString& path, int width, int height, uint32_t fps);
+  ~IvfVideoWriter();
+
+  // Encodes a 4-byte per pixel image in libyuv |fourcc| order. Images
+  // smaller than the video are padded, larger ones are clipped.
+  // |timestamp| is in seconds.
+  bool WriteFrame(const uint8_t* pixels, int stride, uint32_t fourcc, int width, int height, double timestamp);
+
+  // Shows the last frame until |timestamp| and completes the file.
+  void Finish(double timestamp);
+
+ private:
+  IvfVideoWriter(FILE* file, int width, int height, uint32_t fps);
+
+  bool Init();
+  bool Encode(int64_t pts);
+  // Writes out frames still buffered in the encoder.
+  bool Flush();
+  // Returns the number of frames written, or -1 on failure.
+  int WritePackets();
+  bool WriteFileHeader();
+
+  FILE* mFile;
+  vpx_codec_ctx_t mCodec;
+  bool mCodecInitialized = false;
+  vpx_image_t* mImage = nullptr;
+  int mWidth;
+  int mHeight;
+  uint32_t mFps;
+  double mFirstTimestamp = -1;
+  int64_t mLastPts = -1;
+  uint32_t mFrameCount = 0;
+};
+
+}  // namespace mozilla
@@ -0,0 +1,95 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "JpegEncoder.h"
+
+#include <cstring>
+
+namespace mozilla {
+
+namespace {
+
+const size_t kInitialCapacity = 64 * 1024;
+
+}  // namespace
+
+JpegEncoder::JpegEncoder() {
+  mInfo.err = jpeg_std_error(&mError);
+  jpeg_create_compress(&mInfo);
+  mInfo.client_data = this;
+  mDestination.init_destination = &JpegEncoder::InitDestination;
+  mDestination.empty_output_buffer = &JpegEncoder::EmptyOutputBuffer;
+  mDestination.term_destination = &JpegEncoder::TermDestination;
+  mInfo.dest = &mDestination;
+}
+
+JpegEncoder::~JpegEncoder() {
+  jpeg_destroy_compress(&mInfo);
+}
+
+bool JpegEncoder::Encode(const uint8_t* rows, size_t stride, int width, int height, J_COLOR_SPACE colorSpace, int quality) {
+  // Tables only need to be rebuilt when the input format or quality change.
+  if (colorSpace != mColorSpace || quality != mQuality) {
+    mInfo.in_color_space = colorSpace;
+    // # of color components in input image
+    mInfo.input_components = 4;
+    jpeg_set_defaults(&mInfo);
+    jpeg_set_quality(&mInfo, quality, true);
+    mColorSpace = colorSpace;
+    mQuality = quality;
+  }
+
+  mInfo.image_width = width;
+  mInfo.image_height = height;
+  mSize = 0;
+
+  jpeg_start_compress(&mInfo, true);
+  while (mInfo.next_scanline < mInfo.image_height) {
+    JSAMPROW row = const_cast<uint8_t*>(rows) + mInfo.next_scanline * stride;
+    if (jpeg_write_scanlines(&mInfo, &row, 1) != 1) {
+      fprintf(stderr, "JPEG library failed to encode line\n");
+      jpeg_abort_compress(&mInfo);
+      return false;
+    }
+  }
+  jpeg_finish_compress(&mInfo);
+  return true;
+}
+
+void JpegEncoder::Grow(size_t capacity, size_t used) {
+  UniquePtr<uint8_t[]> buffer = MakeUnique<uint8_t[]>(capacity);
+  if (used)
+    memcpy(buffer.get(), mBuffer.get(), used);
+  mBuffer = std::move(buffer);
+  mCapacity = capacity;
+  mAllocations.fetch_add(1);
+}
+
+// static
+void JpegEncoder::InitDestination(j_compress_ptr cinfo) {
+  JpegEncoder* self = static_cast<JpegEncoder*>(cinfo->client_data);
+  if (!self->mCapacity)
+    self->Grow(kInitialCapacity, 0);
+  self->mDestination.next_output_byte = self->mBuffer.get();
+  self->mDestination.free_in_buffer = self->mCapacity;
+}
+
+// static
+boolean JpegEncoder::EmptyOutputBuffer(j_compress_ptr cinfo) {
+  // The buffer is full, keep what is written so far and continue in a larger one.
+  JpegEncoder* self = static_cast<JpegEncoder*>(cinfo->client_data);
+  size_t used = self->mCapacity;
+  self->Grow(self->mCapacity * 2, used);
+  self->mDestination.next_output_byte = self->mBuffer.get() + used;
+  self->mDestination.free_in_buffer = self->mCapacity - used;
+  return true;
+}
+
+// static
+void JpegEncoder::TermDestination(j_compress_ptr cinfo) {
+  JpegEncoder* self = static_cast<JpegEncoder*>(cinfo->client_data);
+  self->mSize = self->mCapacity - self->mDestination.free_in_buffer;
+}
+
+}  // namespace mozilla
@@ -0,0 +1,53 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include "mozilla/UniquePtr.h"
+
+extern "C" {
+#include "jpeglib.h"
+}
+
+namespace mozilla {
+
+// Keeps one libjpeg compressor and a growable output buffer alive across
+// frames, so that steady-state encoding does not allocate. Not thread-safe,
+// callers must serialize Encode() calls.
+class JpegEncoder {
+ public:
+  JpegEncoder();
+  ~JpegEncoder();
+
+  // Compresses |height| rows of 4-byte pixels starting at |rows|.
+  bool Encode(const uint8_t* rows, size_t stride, int width, int height, J_COLOR_SPACE colorSpace, int quality);
+
+  const uint8_t* Data() const { return mBuffer.get(); }
+  size_t Size() const { return mSize; }
+
+  // Number of output buffer (re)allocations so far, readable from any thread.
+  uint32_t Allocations() const { return mAllocations.load(); }
+
+ private:
+  static void InitDestination(j_compress_ptr cinfo);
+  static boolean EmptyOutputBuffer(j_compress_ptr cinfo);
+  static void TermDestination(j_compress_ptr cinfo);
+
+  void Grow(size_t capacity, size_t used);
+
+  jpeg_compress_struct mInfo;
+  jpeg_error_mgr mError;
+  jpeg_destination_mgr mDestination;
+  J_COLOR_SPACE mColorSpace = JCS_UNKNOWN;
+  int mQuality = -1;
+
+  UniquePtr<uint8_t[]> mBuffer;
+  size_t mCapacity = 0;
+  size_t mSize = 0;
+  std::atomic<uint32_t> mAllocations = 0;
+};
+
+}  // namespace mozilla
@@ -4,15 +4,24 @@
 
 #include "nsScreencastService.h"
 
+#include <algorithm>
 #include <bit>
+#include <cstring>
+#include <deque>
 
 #include "gfxPlatform.h"
 #include "HeadlessWidget.h"
 #include "HeadlessWindowCapturer.h"
+#include "IvfVideoWriter.h"
+#include "JpegEncoder.h"
 #include "mozilla/Base64.h"
 #include "mozilla/ClearOnShutdown.h"
+#include "mozilla/Mutex.h"
 #include "mozilla/PresShell.h"
+#include "mozilla/SharedThreadPool.h"
 #include "mozilla/StaticPtr.h"
+#include "mozilla/TaskQueue.h"
+#include "mozilla/UniquePtr.h"
 #include "nsIDocShell.h"
 #include "nsIObserverService.h"
 #include "nsIRandomGenerator.h"
@@ -27,9 +36,6 @@
 #include "video_engine/desktop_capture_impl.h"
 #include "VideoEngine.h"
 
-extern "C" {
-#include "jpeglib.h"
-}
 #include <libyuv.h>
 
 using namespace mozilla::widget;
@@ -40,7 +46,20 @@ NS_IMPL_ISUPPORTS(nsScreencastService, nsIScreencastService)
 
 namespace {
 
-const int kMaxFramesInFlight = 1;
+// Ack latency can slow a session down to this frame interval at most.
+const int64_t kMaxFrameIntervalUs = 1000 * 1000;
+// Frames arriving slightly earlier than the paced interval are still taken
+// to absorb capture timer jitter.
+const int64_t kPacingSlackUs = 5 * 1000;
+// Partial mode compares frames in square tiles of this size.
+const int kTileSize = 64;
+// Partial mode sends a full frame at least this often.
+const double kKeyFrameIntervalSeconds = 2;
+// Upper bound on the number of encoder threads shared by all sessions.
+const uint32_t kEncoderThreadLimit = 4;
+// Video recordings are not acked, their frames are in flight until written
+// to the file. This bounds the encoder queue of a recording.
+const uint32_t kVideoFramesInFlight = 2;
 
 StaticRefPtr<nsScreencastService> gScreencastService;
 
@@ -77,40 +96,256 @@ nsresult generateUid(nsString& uid) {
   free(buffer);
   return rv;
 }
+
+class ScreencastSessionStats final : public nsIScreencastSessionStats {
+ public:
+  NS_DECL_ISUPPORTS
+  NS_DECL_NSISCREENCASTSESSIONSTATS
+
+  ScreencastSessionStats(uint32_t framesEncoded, uint32_t framesDropped, double meanLatencyMs, double maxLatencyMs, double meanEncodeMs, uint32_t heapAllocations, double ackLatencyMs, double frameIntervalMs)
+      : mFramesEncoded(framesEncoded)
+      , mFramesDropped(framesDropped)
+      , mMeanLatencyMs(meanLatencyMs)
+      , mMaxLatencyMs(maxLatencyMs)
+      , mMeanEncodeMs(meanEncodeMs)
+      , mHeapAllocations(heapAllocations)
+      , mAckLatencyMs(ackLatencyMs)
+      , mFrameIntervalMs(frameIntervalMs) {
+  }
+
+ private:
+  ~ScreencastSessionStats() = default;
+
+  uint32_t mFramesEncoded;
+  uint32_t mFramesDropped;
+  double mMeanLatencyMs;
+  double mMaxLatencyMs;
+  double mMeanEncodeMs;
+  uint32_t mHeapAllocations;
+  double mAckLatencyMs;
+  double mFrameIntervalMs;
+};
+
+NS_IMPL_ISUPPORTS(ScreencastSessionStats, nsIScreencastSessionStats)
+
+NS_IMETHODIMP ScreencastSessionStats::GetFramesEncoded(uint32_t* aFramesEncoded) {
+  *aFramesEncoded = mFramesEncoded;
+  return NS_OK;
+}
+
+NS_IMETHODIMP ScreencastSessionStats::GetFramesDropped(uint32_t* aFramesDropped) {
+  *aFramesDropped = mFramesDropped;
+  return NS_OK;
+}
+
+NS_IMETHODIMP ScreencastSessionStats::GetMeanLatencyMs(double* aMeanLatencyMs) {
+  *aMeanLatencyMs = mMeanLatencyMs;
+  return NS_OK;
 }
 
-class nsScreencastService::Session : public webrtc::RawFrameCallback {
+NS_IMETHODIMP ScreencastSessionStats::GetMaxLatencyMs(double* aMaxLatencyMs) {
+  *aMaxLatencyMs = mMaxLatencyMs;
+  return NS_OK;
+}
+
+NS_IMETHODIMP ScreencastSessionStats::GetMeanEncodeMs(double* aMeanEncodeMs) {
+  *aMeanEncodeMs = mMeanEncodeMs;
+  return NS_OK;
+}
+
+NS_IMETHODIMP ScreencastSessionStats::GetHeapAllocations(uint32_t* aHeapAllocations) {
+  *aHeapAllocations = mHeapAllocations;
+  return NS_OK;
+}
+
+NS_IMETHODIMP ScreencastSessionStats::GetAckLatencyMs(double* aAckLatencyMs) {
+  *aAckLatencyMs = mAckLatencyMs;
+  return NS_OK;
+}
+
+NS_IMETHODIMP ScreencastSessionStats::GetFrameIntervalMs(double* aFrameIntervalMs) {
+  *aFrameIntervalMs = mFrameIntervalMs;
+  return NS_OK;
+}
+
+}
+
+// Client side of a screencast: paces frames by the client's acks and keeps
+// per-client stats. Frames are produced by an Encoder that may be shared with
+// other sessions of the same page.
+class nsScreencastService::Session {
   Session(
     nsIScreencastServiceClient* client,
+    RefPtr<Encoder>&& encoder,
+    uint32_t fps,
+    uint32_t maxFramesInFlight)
+      : mClient(client)
+      , mEncoder(std::move(encoder))
+      , mFps(fps)
+      , mMaxFramesInFlight(maxFramesInFlight)
+      , mTargetFrameIntervalUs(1000 * 1000 / fps)
+      , mFrameIntervalUs(mTargetFrameIntervalUs) {
+  }
+  ~Session();
+
+ public:
+  NS_INLINE_DECL_THREADSAFE_REFCOUNTING(Session)
+  static RefPtr<Session> Create(
+    nsIScreencastServiceClient* client,
+    RefPtr<Encoder>&& encoder,
+    uint32_t fps,
+    uint32_t maxFramesInFlight) {
+    return do_AddRef(new Session(client, std::move(encoder), fps, maxFramesInFlight));
+  }
+
+  Encoder* GetEncoder() const { return mEncoder; }
+  uint32_t Fps() const { return mFps; }
+  uint32_t MaxFramesInFlight() const { return mMaxFramesInFlight; }
+
+  bool Start();
+  void Stop();
+
+  void ScreencastFrameAck() {
+    if (mFramesInFlight.load() == 0) {
+      fprintf(stderr, "ScreencastFrameAck is called while there are no inflight frames\n");
+      return;
+    }
+    mFramesInFlight.fetch_sub(1);
+
+    if (mFrameSendTimes.empty())
+      return;
+    double latencyUs = (TimeStamp::Now() - mFrameSendTimes.front()).ToMicroseconds();
+    mFrameSendTimes.pop_front();
+    mAckLatencyUs = mAckLatencyUs ? mAckLatencyUs * 0.8 + latencyUs * 0.2 : latencyUs;
+    // With N frames in flight, the client keeps up with one frame per
+    // latency / N. Slow consumers get fewer frames instead of drops.
+    int64_t intervalUs = static_cast<int64_t>(mAckLatencyUs / mMaxFramesInFlight);
+    mFrameIntervalUs = std::clamp(intervalUs, mTargetFrameIntervalUs, std::max(mTargetFrameIntervalUs, kMaxFrameIntervalUs));
+  }
+
+  already_AddRefed<nsIScreencastSessionStats> GetStats();
+
+  // Called on the capture thread for every captured frame. Returns true when
+  // the session takes the frame, it is then in flight until acked or until
+  // ReleaseFrame().
+  bool WantsFrame(TimeStamp now) {
+    if (!mLastFrameTime.IsNull() && (now - mLastFrameTime).ToMicroseconds() + kPacingSlackUs < mFrameIntervalUs.load())
+      return false;
+
+    // Frames waiting for the encoder count as in flight, so the encoder
+    // queue never grows beyond mMaxFramesInFlight.
+    if (mFramesInFlight.load() >= mMaxFramesInFlight) {
+      mFramesDropped.fetch_add(1);
+      return false;
+    }
+    mLastFrameTime = now;
+    mFramesInFlight.fetch_add(1);
+    return true;
+  }
+
+  // Ends a frame that the client will not ack: it was not sent, or it went
+  // to a video file.
+  void ReleaseFrame() {
+    mFramesInFlight.fetch_sub(1);
+  }
+
+  void FrameEncoded(uint64_t latencyUs, uint64_t encodeUs) {
+    mFramesEncoded.fetch_add(1);
+    mTotalLatencyUs.fetch_add(latencyUs);
+    mTotalEncodeUs.fetch_add(encodeUs);
+    uint64_t maxLatencyUs = mMaxLatencyUs.load();
+    while (latencyUs > maxLatencyUs && !mMaxLatencyUs.compare_exchange_weak(maxLatencyUs, latencyUs)) {
+    }
+  }
+
+  // Main thread only.
+  void SendFrame(const nsCString& frame, int pageWidth, int pageHeight, double timestamp) {
+    if (mStopped)
+      return;
+    mFrameSendTimes.push_back(TimeStamp::Now());
+    mClient->ScreencastFrame(frame, pageWidth, pageHeight, timestamp);
+  }
+
+  void SendTiles(const nsTArray<nsCString>& tiles, const nsTArray<uint32_t>& rects, int pageWidth, int pageHeight, double timestamp) {
+    if (mStopped)
+      return;
+    mFrameSendTimes.push_back(TimeStamp::Now());
+    mClient->ScreencastTiles(tiles, rects, pageWidth, pageHeight, timestamp);
+  }
+
+  void NotifyStopped() {
+    mClient->ScreencastStopped();
+  }
+
+ private:
+  RefPtr<nsIScreencastServiceClient> mClient;
+  RefPtr<Encoder> mEncoder;
+  uint32_t mFps;
+  uint32_t mMaxFramesInFlight;
+  // Pacing: the frame interval grows above the target when the client is
+  // slow to ack frames.
+  int64_t mTargetFrameIntervalUs;
+  std::atomic<int64_t> mFrameIntervalUs;
+  TimeStamp mLastFrameTime;  // Capture thread only.
+  std::deque<TimeStamp> mFrameSendTimes;  // Main thread only.
+  double mAckLatencyUs = 0;  // Main thread only.
+  std::atomic<bool> mStopped = false;
+  std::atomic<uint32_t> mFramesInFlight = 0;
+  std::atomic<uint32_t> mFramesEncoded = 0;
+  std::atomic<uint32_t> mFramesDropped = 0;
+  std::atomic<uint64_t> mTotalLatencyUs = 0;
+  std::atomic<uint64_t> mMaxLatencyUs = 0;
+  std::atomic<uint64_t> mTotalEncodeUs = 0;
+};
+
+// Scales and encodes the frames of one capturer for one output variant
+// (size, crop and quality), and fans the result out to every session that
+// takes the frame. Sessions observing the same page with the same options
+// share an encoder, so a frame is copied and encoded once no matter how many
+// clients watch it. Partial mode tracks what each client shows, such
+// sessions always get an encoder of their own. So do video recordings, which
+// write VP8 to a file instead of sending JPEGs.
+class nsScreencastService::Encoder : public webrtc::RawFrameCallback {
+  Encoder(
     nsIWidget* widget,
     webrtc::scoped_refptr<webrtc::VideoCaptureModuleEx>&& capturer,
     int width, int height,
     int viewportWidth, int viewportHeight,
     gfx::IntMargin margin,
-    uint32_t jpegQuality)
-      : mClient(client)
-      , mWidget(widget)
+    uint32_t jpegQuality,
+    bool partialFrames,
+    bool rawFrames,
+    UniquePtr<IvfVideoWriter>&& videoWriter)
+      : mWidget(widget)
       , mCaptureModule(std::move(capturer))
+      , mEncoderQueue(TaskQueue::Create(SharedThreadPool::Get("ScreencastEncoder"_ns, kEncoderThreadLimit), "ScreencastEncoder"))
       , mJpegQuality(jpegQuality)
+      , mPartialFrames(partialFrames)
+      , mRawFrames(rawFrames)
+      , mVideoWriter(std::move(videoWriter))
+      , mSessionsLock("nsScreencastService::Encoder::mSessionsLock")
+      , mFramePoolLock("nsScreencastService::Encoder::mFramePoolLock")
       , mWidth(width)
       , mHeight(height)
       , mViewportWidth(viewportWidth)
       , mViewportHeight(viewportHeight)
       , mMargin(margin) {
   }
-  ~Session() override = default;
+  ~Encoder() override = default;
 
  public:
-  NS_INLINE_DECL_THREADSAFE_REFCOUNTING(Session)
-  static RefPtr<Session> Create(
-    nsIScreencastServiceClient* client,
+  NS_INLINE_DECL_THREADSAFE_REFCOUNTING(Encoder)
+  static RefPtr<Encoder> Create(
     nsIWidget* widget,
     webrtc::scoped_refptr<webrtc::VideoCaptureModuleEx>&& capturer,
     int width, int height,
     int viewportWidth, int viewportHeight,
     gfx::IntMargin margin,
-    uint32_t jpegQuality) {
-    return do_AddRef(new Session(client, widget, std::move(capturer), width, height, viewportWidth, viewportHeight, margin, jpegQuality));
+    uint32_t jpegQuality,
+    bool partialFrames,
+    bool rawFrames,
+    UniquePtr<IvfVideoWriter>&& videoWriter) {
+    return do_AddRef(new Encoder(widget, std::move(capturer), width, height, viewportWidth, viewportHeight, margin, jpegQuality, partialFrames, rawFrames, std::move(videoWriter)));
   }
 
   webrtc::scoped_refptr<webrtc::VideoCaptureModuleEx> ReuseCapturer(nsIWidget* widget) {
@@ -119,44 +354,89 @@ class nsScreencastService::Session : public webrtc::RawFrameCallback {
     return nullptr;
   }
 
-  bool Start() {
+  bool Matches(nsIWidget* widget, int width, int height, int viewportWidth, int viewportHeight, const gfx::IntMargin& margin, uint32_t jpegQuality, bool partialFrames, bool rawFrames) const {
+    return !mPartialFrames && !partialFrames && !mVideoWriter && !mStopped &&
+           mWidget == widget && mWidth == width && mHeight == height &&
+           mViewportWidth == viewportWidth && mViewportHeight == viewportHeight &&
+           mMargin == margin && mJpegQuality == jpegQuality && mRawFrames == rawFrames;
+  }
+
+  // Main thread only. The first session starts capturing.
+  bool AddSession(Session* session) {
+    bool first;
+    {
+      MutexAutoLock lock(mSessionsLock);
+      first = mSessions.empty();
+      mSessions.push_back(session);
+    }
+    {
+      MutexAutoLock lock(mFramePoolLock);
+      mMaxPooledFrames = std::max(mMaxPooledFrames, session->MaxFramesInFlight());
+    }
+    if (!first) {
+      // The capturer only sends frames on paint, make sure the new session
+      // gets the current content.
+      mCaptureModule->RegisterRawFrameCallback(this);
+      return true;
+    }
+
     webrtc::VideoCaptureCapability capability;
     // The size is ignored in fact.
     capability.width = 1280;
     capability.height = 960;
-    capability.maxFPS = 25;
+    // The capture rate is decided by the session that starts the capturer,
+    // sessions joining later pace themselves below it.
+    capability.maxFPS = session->Fps();
     capability.videoType = webrtc::VideoType::kI420;
     int error = mCaptureModule->StartCaptureCounted(capability);
     if (error) {
       fprintf(stderr, "StartCapture error %d\n", error);
+      RemoveSession(session);
       return false;
     }
 
     mCaptureModule->RegisterRawFrameCallback(this);
+    mCapturing = true;
     return true;
   }
 
-  void Stop() {
-    if (mStopped) {
-      fprintf(stderr, "Screencast session has already been stopped\n");
-      return;
+  // Main thread only. Capturing stops with the last session.
+  void RemoveSession(Session* session) {
+    {
+      MutexAutoLock lock(mSessionsLock);
+      mSessions.erase(std::remove(mSessions.begin(), mSessions.end(), session), mSessions.end());
+      if (!mSessions.empty())
+        return;
     }
     mStopped = true;
-    mCaptureModule->DeRegisterRawFrameCallback(this);
-    mCaptureModule->StopCaptureCounted();
-  }
-
-  void ScreencastFrameAck() {
-    if (mFramesInFlight.load() == 0) {
-      fprintf(stderr, "ScreencastFrameAck is called while there are no inflight frames\n");
-      return;
+    if (mCapturing) {
+      mCaptureModule->DeRegisterRawFrameCallback(this);
+      mCaptureModule->StopCaptureCounted();
+      mCapturing = false;
     }
-    mFramesInFlight.fetch_sub(1);
+    if (mVideoWriter) {
+      double timestamp = (TimeStamp::Now() - TimeStamp::ProcessCreation()).ToSeconds();
+      mEncoderQueue->Dispatch(NS_NewRunnableFunction(
+          "nsScreencastService::Encoder::FinishVideo", [this, protect = RefPtr{this}, session = RefPtr{session}, timestamp]() -> void {
+            mVideoWriter->Finish(timestamp);
+            NS_DispatchToMainThread(NS_NewRunnableFunction(
+                "NotifyScreencastStopped", [session]() -> void {
+                  session->NotifyStopped();
+                }));
+          }));
+    }
+    mEncoderQueue->BeginShutdown();
   }
 
+  uint32_t Allocations() const {
+    return mAllocations.load() + mJpegEncoder.Allocations();
+  }
 
   // These callbacks end up running on the VideoCapture thread.
-  void OnRawFrame(uint8_t* videoFrame, size_t videoFrameStride, const webrtc::VideoCaptureCapability& frameInfo) override {
+  void OnRawFrame(uint8_t* videoFrame, size_t videoFrameStride, const webrtc::VideoCaptureCapability& frameInfo, const webrtc::DesktopRect& dirtyRect) override {
+    // Damage of skipped frames has to be carried over to the next one.
+    mPendingDirtyRect = mPendingDirtyRect.Union(gfx::IntRect(dirtyRect.left(), dirtyRect.top(), dirtyRect.width(), dirtyRect.height()));
+
     int pageWidth = frameInfo.width - mMargin.LeftRight();
     int pageHeight = frameInfo.height - mMargin.TopBottom();
     // Frame size is 1x1 when browser window is minimized.
@@ -168,106 +448,318 @@ class nsScreencastService::Session : public webrtc::RawFrameCallback {
     if (mViewportHeight && pageHeight > mViewportHeight)
       pageHeight = mViewportHeight;
 
-    if (mFramesInFlight.load() >= kMaxFramesInFlight)
+    TimeStamp now = TimeStamp::Now();
+    CapturedFrame frame;
+    {
+      MutexAutoLock lock(mSessionsLock);
+      for (Session* session : mSessions) {
+        if (session->WantsFrame(now))
+          frame.sessions.AppendElement(session);
+      }
+    }
+    if (frame.sessions.IsEmpty())
+      return;
+
+    // The frame data is only valid for the duration of this call, copy it
+    // and leave scaling and compression to the encoder thread. Only the page
+    // is copied, so that nothing downstream touches the window frame and
+    // toolbar pixels.
+    frame.stride = pageWidth * 4;
+    frame.size = frame.stride * pageHeight;
+    frame.data = AcquireFrameBuffer(frame.size);
+    if (!frame.data) {
+      fprintf(stderr, "Failed to allocate screencast frame\n");
+      ReleaseFrames(frame);
       return;
+    }
+    const uint8_t* page = videoFrame + mMargin.top * videoFrameStride + mMargin.left * 4;
+    libyuv::ARGBCopy(page, videoFrameStride, frame.data.get(), frame.stride, pageWidth, pageHeight);
+    frame.info = frameInfo;
+    frame.pageWidth = pageWidth;
+    frame.pageHeight = pageHeight;
+    frame.captureTime = now;
+    frame.dirtyRect = mPendingDirtyRect - gfx::IntPoint(mMargin.left, mMargin.top);
+    mPendingDirtyRect.SetEmpty();
+    frame.timestamp = (frame.captureTime - TimeStamp::ProcessCreation()).ToSeconds();
+
+    nsTArray<RefPtr<Session>> sessions = frame.sessions.Clone();
+    nsresult rv = mEncoderQueue->Dispatch(NS_NewRunnableFunction(
+        "nsScreencastService::Encoder::EncodeFrame", [this, protect = RefPtr{this}, frame = std::move(frame)]() mutable -> void {
+          EncodeFrame(std::move(frame));
+        }));
+    if (NS_FAILED(rv)) {
+      for (const auto& session : sessions)
+        session->ReleaseFrame();
+    }
+  }
+
+ private:
+  struct CapturedFrame {
+    UniquePtr<uint8_t[]> data;
+    size_t size = 0;
+    int stride = 0;
+    webrtc::VideoCaptureCapability info;
+    int pageWidth = 0;
+    int pageHeight = 0;
+    double timestamp = 0;
+    TimeStamp captureTime;
+    gfx::IntRect dirtyRect;
+    // Sessions that took this frame.
+    nsTArray<RefPtr<Session>> sessions;
+  };
+
+  static void ReleaseFrames(const CapturedFrame& frame) {
+    for (const auto& session : frame.sessions)
+      session->ReleaseFrame();
+  }
 
-    double timestamp = (TimeStamp::Now() - TimeStamp::ProcessCreation()).ToSeconds();
+  // Frame copies are handed back by the encoder, so that capturing a frame of
+  // unchanged size does not allocate.
+  UniquePtr<uint8_t[]> AcquireFrameBuffer(size_t size) {
+    {
+      MutexAutoLock lock(mFramePoolLock);
+      if (mFramePoolBufferSize == size && !mFramePool.empty()) {
+        UniquePtr<uint8_t[]> buffer = std::move(mFramePool.back());
+        mFramePool.pop_back();
+        return buffer;
+      }
+    }
+    mAllocations.fetch_add(1);
+    return MakeUniqueFallible<uint8_t[]>(size);
+  }
+
+  void RecycleFrameBuffer(UniquePtr<uint8_t[]>&& buffer, size_t size) {
+    MutexAutoLock lock(mFramePoolLock);
+    if (mFramePoolBufferSize != size) {
+      mFramePool.clear();
+      mFramePoolBufferSize = size;
+    }
+    if (mFramePool.size() < mMaxPooledFrames)
+      mFramePool.push_back(std::move(buffer));
+  }
+
+  uint8_t* EnsureCanvas(size_t size) {
+    if (mCanvasSize < size) {
+      mCanvas = MakeUnique<uint8_t[]>(size);
+      mCanvasSize = size;
+      mAllocations.fetch_add(1);
+    }
+    return mCanvas.get();
+  }
+
+  // Runs on the encoder queue, frames of one encoder are encoded in order.
+  void EncodeFrame(CapturedFrame&& frame) {
+    // Frames queued before the last session went away still hold a pool slot
+    // and an in-flight slot of each session.
+    if (mStopped) {
+      RecycleFrameBuffer(std::move(frame.data), frame.size);
+      ReleaseFrames(frame);
+      return;
+    }
+
+    TimeStamp encodeStart = TimeStamp::Now();
+    const webrtc::VideoCaptureCapability& frameInfo = frame.info;
+    int pageWidth = frame.pageWidth;
+    int pageHeight = frame.pageHeight;
     int screenshotWidth = pageWidth;
     int screenshotHeight = pageHeight;
-    int screenshotTopMargin = mMargin.top;
-    std::unique_ptr<uint8_t[]> canvas;
-    uint8_t* canvasPtr = videoFrame;
-    int canvasStride = videoFrameStride;
+    const uint8_t* image = frame.data.get();
+    int imageStride = frame.stride;
+    double scale = 1.;
 
+    // The frame is already cropped to the page, scale it straight to the
+    // output size. Conversion from BGRA is left to libjpeg-turbo, which does
+    // it while loading scanlines.
     if (mWidth < pageWidth || mHeight < pageHeight) {
-      double scale = std::min(1., std::min((double)mWidth / pageWidth, (double)mHeight / pageHeight));
-      int canvasWidth = frameInfo.width * scale;
-      int canvasHeight = frameInfo.height * scale;
-      canvasStride = canvasWidth * 4;
-
+      scale = std::min(1., std::min((double)mWidth / pageWidth, (double)mHeight / pageHeight));
       screenshotWidth *= scale;
       screenshotHeight *= scale;
-      screenshotTopMargin *= scale;
-
-      canvas.reset(new uint8_t[canvasWidth * canvasHeight * 4]);
-      canvasPtr = canvas.get();
-      libyuv::ARGBScale(videoFrame,
-                        videoFrameStride,
-                        frameInfo.width,
-                        frameInfo.height,
+      imageStride = screenshotWidth * 4;
+
+      uint8_t* canvasPtr = EnsureCanvas(imageStride * screenshotHeight);
+      libyuv::ARGBScale(frame.data.get(),
+                        frame.stride,
+                        pageWidth,
+                        pageHeight,
                         canvasPtr,
-                        canvasStride,
-                        canvasWidth,
-                        canvasHeight,
+                        imageStride,
+                        screenshotWidth,
+                        screenshotHeight,
                         libyuv::kFilterBilinear);
+      image = canvasPtr;
     }
 
-    jpeg_compress_struct info;
-    jpeg_error_mgr error;
-    info.err = jpeg_std_error(&error);
-    jpeg_create_compress(&info);
-
-    unsigned char* bufferPtr = nullptr;
-    unsigned long bufferSize;
-    jpeg_mem_dest(&info, &bufferPtr, &bufferSize);
-
-    info.image_width = screenshotWidth;
-    info.image_height = screenshotHeight;
-
+    J_COLOR_SPACE colorSpace = JCS_UNKNOWN;
     if constexpr (std::endian::native == std::endian::little) {
       if (frameInfo.videoType == webrtc::VideoType::kARGB)
-        info.in_color_space = JCS_EXT_BGRA;
+        colorSpace = JCS_EXT_BGRA;
       if (frameInfo.videoType == webrtc::VideoType::kBGRA)
-        info.in_color_space = JCS_EXT_ARGB;
+        colorSpace = JCS_EXT_ARGB;
     } else {
       if (frameInfo.videoType == webrtc::VideoType::kARGB)
-        info.in_color_space = JCS_EXT_ARGB;
+        colorSpace = JCS_EXT_ARGB;
       if (frameInfo.videoType == webrtc::VideoType::kBGRA)
-        info.in_color_space = JCS_EXT_BGRA;
+        colorSpace = JCS_EXT_BGRA;
     }
 
-    // # of color components in input image
-    info.input_components = 4;
+    bool sent;
+    if (mVideoWriter) {
+      uint32_t fourcc = frameInfo.videoType == webrtc::VideoType::kBGRA ? libyuv::FOURCC_BGRA : libyuv::FOURCC_ARGB;
+      sent = mVideoWriter->WriteFrame(image, imageStride, fourcc, screenshotWidth, screenshotHeight, frame.timestamp);
+    } else if (mPartialFrames && !NeedsKeyFrame(screenshotWidth, screenshotHeight, frame.captureTime)) {
+      // Map the damage into the image, with some room for the scaling filter.
+      gfx::IntRect damage = frame.dirtyRect;
+      damage.ScaleRoundOut(scale);
+      damage.Inflate(2);
+      damage = damage.Intersect(gfx::IntRect(0, 0, screenshotWidth, screenshotHeight));
+      sent = EncodeTiles(image, imageStride, screenshotWidth, screenshotHeight, damage, colorSpace, frame);
+    } else {
+      sent = EncodeKeyFrame(image, imageStride, screenshotWidth, screenshotHeight, colorSpace, frame);
+    }
+    RecycleFrameBuffer(std::move(frame.data), frame.size);
+    if (!sent || mVideoWriter)
+      ReleaseFrames(frame);
+    if (!sent)
+      return;
 
-    jpeg_set_defaults(&info);
-    jpeg_set_quality(&info, mJpegQuality, true);
+    TimeStamp encodeEnd = TimeStamp::Now();
+    uint64_t latencyUs = (encodeEnd - frame.captureTime).ToMicroseconds();
+    uint64_t encodeUs = (encodeEnd - encodeStart).ToMicroseconds();
+    for (const auto& session : frame.sessions)
+      session->FrameEncoded(latencyUs, encodeUs);
+  }
 
-    jpeg_start_compress(&info, true);
-    while (info.next_scanline < info.image_height) {
-      JSAMPROW row = canvasPtr + (screenshotTopMargin + info.next_scanline) * canvasStride;
-      if (jpeg_write_scanlines(&info, &row, 1) != 1) {
-        fprintf(stderr, "JPEG library failed to encode line\n");
-        break;
-      }
+  bool EncodeKeyFrame(const uint8_t* image, int stride, int width, int height, J_COLOR_SPACE colorSpace, const CapturedFrame& frame) {
+    if (!mJpegEncoder.Encode(image, stride, width, height, colorSpace, mJpegQuality))
+      return false;
+
+    nsCString encoded;
+    if (!TakeEncodedImage(encoded))
+      return false;
+
+    if (mPartialFrames) {
+      // Remember what the client shows, tiles are computed against it.
+      mPreviousImage.resize(width * height * 4);
+      libyuv::ARGBCopy(image, stride, mPreviousImage.data(), width * 4, width, height);
+      mPreviousImageSize = gfx::IntSize(width, height);
+      mLastKeyFrameTime = frame.captureTime;
     }
 
-    jpeg_finish_compress(&info);
-    jpeg_destroy_compress(&info);
+    int pageWidth = frame.pageWidth;
+    int pageHeight = frame.pageHeight;
+    double timestamp = frame.timestamp;
+    NS_DispatchToMainThread(NS_NewRunnableFunction(
+        "NotifyScreencastFrame", [sessions = frame.sessions.Clone(), encoded = std::move(encoded), pageWidth, pageHeight, timestamp]() -> void {
+          for (const auto& session : sessions)
+            session->SendFrame(encoded, pageWidth, pageHeight, timestamp);
+        }));
+    return true;
+  }
 
-    nsCString base64;
-    nsresult rv = mozilla::Base64Encode(reinterpret_cast<char *>(bufferPtr), bufferSize, base64);
-    free(bufferPtr);
-    if (NS_WARN_IF(NS_FAILED(rv))) {
-      return;
+  // Copies out the last JPEG, Base64 encoded unless the client takes raw
+  // bytes.
+  bool TakeEncodedImage(nsCString& image) {
+    if (mRawFrames) {
+      image.Assign(reinterpret_cast<const char*>(mJpegEncoder.Data()), mJpegEncoder.Size());
+      return true;
     }
+    nsresult rv = mozilla::Base64Encode(reinterpret_cast<const char*>(mJpegEncoder.Data()), mJpegEncoder.Size(), image);
+    return !NS_WARN_IF(NS_FAILED(rv));
+  }
 
-    mFramesInFlight.fetch_add(1);
+  bool NeedsKeyFrame(int width, int height, TimeStamp now) {
+    return mPreviousImageSize != gfx::IntSize(width, height) ||
+           (now - mLastKeyFrameTime).ToSeconds() >= kKeyFrameIntervalSeconds;
+  }
+
+  bool TileChanged(const uint8_t* image, int stride, const gfx::IntRect& tile) {
+    int previousStride = mPreviousImageSize.width * 4;
+    for (int y = tile.Y(); y < tile.YMost(); ++y) {
+      if (memcmp(image + y * stride + tile.X() * 4, mPreviousImage.data() + y * previousStride + tile.X() * 4, tile.Width() * 4))
+        return true;
+    }
+    return false;
+  }
+
+  // Encodes horizontal runs of changed tiles within |damage| as separate
+  // JPEGs. Returns false when nothing has actually changed or encoding
+  // failed, the reference image is only updated once all runs are encoded.
+  bool EncodeTiles(const uint8_t* image, int stride, int width, int height, const gfx::IntRect& damage, J_COLOR_SPACE colorSpace, const CapturedFrame& frame) {
+    nsTArray<nsCString> tiles;
+    nsTArray<uint32_t> rects;
+    nsTArray<gfx::IntRect> runs;
+    int previousStride = mPreviousImageSize.width * 4;
+    for (int tileY = damage.Y() / kTileSize * kTileSize; tileY < damage.YMost(); tileY += kTileSize) {
+      int tileHeight = std::min(kTileSize, height - tileY);
+      int runStart = -1;
+      for (int tileX = damage.X() / kTileSize * kTileSize; ; tileX += kTileSize) {
+        bool changed = tileX < damage.XMost() &&
+            TileChanged(image, stride, gfx::IntRect(tileX, tileY, std::min(kTileSize, width - tileX), tileHeight));
+        if (changed && runStart == -1)
+          runStart = tileX;
+        if (changed)
+          continue;
+        if (runStart != -1) {
+          gfx::IntRect run(runStart, tileY, std::min(tileX, width) - runStart, tileHeight);
+          const uint8_t* runData = image + run.Y() * stride + run.X() * 4;
+          if (!mJpegEncoder.Encode(runData, stride, run.Width(), run.Height(), colorSpace, mJpegQuality))
+            return false;
+          if (!TakeEncodedImage(*tiles.AppendElement()))
+            return false;
+          rects.AppendElements(std::initializer_list<uint32_t>{
+              uint32_t(run.X()), uint32_t(run.Y()), uint32_t(run.Width()), uint32_t(run.Height())});
+          runs.AppendElement(run);
+          runStart = -1;
+        }
+        if (tileX >= damage.XMost())
+          break;
+      }
+    }
+    if (tiles.IsEmpty())
+      return false;
+
+    for (const auto& run : runs) {
+      const uint8_t* runData = image + run.Y() * stride + run.X() * 4;
+      libyuv::ARGBCopy(runData, stride, mPreviousImage.data() + run.Y() * previousStride + run.X() * 4, previousStride, run.Width(), run.Height());
+    }
+
+    int pageWidth = frame.pageWidth;
+    int pageHeight = frame.pageHeight;
+    double timestamp = frame.timestamp;
     NS_DispatchToMainThread(NS_NewRunnableFunction(
-        "NotifyScreencastFrame", [this, protect = RefPtr{this}, base64, pageWidth, pageHeight, timestamp]() -> void {
-          if (mStopped)
-            return;
-          NS_ConvertUTF8toUTF16 utf16(base64);
-          mClient->ScreencastFrame(utf16, pageWidth, pageHeight, timestamp);
+        "NotifyScreencastTiles", [sessions = frame.sessions.Clone(), tiles = std::move(tiles), rects = std::move(rects), pageWidth, pageHeight, timestamp]() -> void {
+          for (const auto& session : sessions)
+            session->SendTiles(tiles, rects, pageWidth, pageHeight, timestamp);
         }));
+    return true;
   }
 
- private:
-  RefPtr<nsIScreencastServiceClient> mClient;
   nsIWidget* mWidget;
   webrtc::scoped_refptr<webrtc::VideoCaptureModuleEx> mCaptureModule;
+  RefPtr<TaskQueue> mEncoderQueue;
   uint32_t mJpegQuality;
-  bool mStopped = false;
-  std::atomic<uint32_t> mFramesInFlight = 0;
+  bool mCapturing = false;  // Main thread only.
+  // Partial mode state: the image last shown by the client is kept on the
+  // encoder queue, damage is accumulated on the capture thread.
+  bool mPartialFrames;
+  bool mRawFrames;
+  UniquePtr<IvfVideoWriter> mVideoWriter;  // Encoder queue only.
+  gfx::IntRect mPendingDirtyRect;
+  std::vector<uint8_t> mPreviousImage;
+  gfx::IntSize mPreviousImageSize;
+  TimeStamp mLastKeyFrameTime;
+  std::atomic<bool> mStopped = false;
+  std::atomic<uint32_t> mAllocations = 0;
+  Mutex mSessionsLock;
+  std::vector<Session*> mSessions MOZ_GUARDED_BY(mSessionsLock);
+  // Encoder state, only used on mEncoderQueue.
+  JpegEncoder mJpegEncoder;
+  UniquePtr<uint8_t[]> mCanvas;
+  size_t mCanvasSize = 0;
+  Mutex mFramePoolLock;
+  std::vector<UniquePtr<uint8_t[]>> mFramePool MOZ_GUARDED_BY(mFramePoolLock);
+  size_t mFramePoolBufferSize MOZ_GUARDED_BY(mFramePoolLock) = 0;
+  uint32_t mMaxPooledFrames MOZ_GUARDED_BY(mFramePoolLock) = 0;
   int mWidth;
   int mHeight;
   int mViewportWidth;
@@ -275,6 +767,31 @@ class nsScreencastService::Session : public webrtc::RawFrameCallback {
   gfx::IntMargin mMargin;
 };
 
+nsScreencastService::Session::~Session() = default;
+
+bool nsScreencastService::Session::Start() {
+  return mEncoder->AddSession(this);
+}
+
+void nsScreencastService::Session::Stop() {
+  if (mStopped) {
+    fprintf(stderr, "Screencast session has already been stopped\n");
+    return;
+  }
+  mStopped = true;
+  mEncoder->RemoveSession(this);
+}
+
+already_AddRefed<nsIScreencastSessionStats> nsScreencastService::Session::GetStats() {
+  uint32_t framesEncoded = mFramesEncoded.load();
+  double meanLatencyMs = framesEncoded ? mTotalLatencyUs.load() / 1000. / framesEncoded : 0;
+  double meanEncodeMs = framesEncoded ? mTotalEncodeUs.load() / 1000. / framesEncoded : 0;
+  RefPtr<nsIScreencastSessionStats> stats = new ScreencastSessionStats(
+      framesEncoded, mFramesDropped.load(), meanLatencyMs, mMaxLatencyUs.load() / 1000., meanEncodeMs,
+      mEncoder->Allocations(), mAckLatencyUs / 1000., mFrameIntervalUs.load() / 1000.);
+  return stats.forget();
+}
+
 
 // static
 already_AddRefed<nsIScreencastService> nsScreencastService::GetSingleton() {
@@ -292,8 +809,21 @@ nsScreencastService::nsScreencastService() = default;
 nsScreencastService::~nsScreencastService() {
 }
 
-nsresult nsScreencastService::StartScreencast(nsIScreencastServiceClient* aClient, nsIDocShell* aDocShell, uint32_t width, uint32_t height, uint32_t quality, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t offsetTop, nsAString& sessionId) {
+nsresult nsScreencastService::StartScreencast(nsIScreencastServiceClient* aClient, nsIDocShell* aDocShell, uint32_t width, uint32_t height, uint32_t quality, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t offsetTop, uint32_t fps, uint32_t maxFramesInFlight, bool partialFrames, bool rawFrames, nsAString& sessionId) {
+  MOZ_RELEASE_ASSERT(NS_IsMainThread(), "Screencast service must be started on the Main thread.");
+  if (!fps || !maxFramesInFlight)
+    return NS_ERROR_INVALID_ARG;
+  return StartSession(aClient, aDocShell, width, height, quality, viewportWidth, viewportHeight, offsetTop, fps, maxFramesInFlight, partialFrames, rawFrames, EmptyCString(), sessionId);
+}
+
+nsresult nsScreencastService::StartVideoRecording(nsIScreencastServiceClient* aClient, nsIDocShell* aDocShell, const nsACString& aFile, uint32_t width, uint32_t height, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t offsetTop, uint32_t fps, nsAString& sessionId) {
   MOZ_RELEASE_ASSERT(NS_IsMainThread(), "Screencast service must be started on the Main thread.");
+  if (!fps || aFile.IsEmpty())
+    return NS_ERROR_INVALID_ARG;
+  return StartSession(aClient, aDocShell, width, height, 0, viewportWidth, viewportHeight, offsetTop, fps, kVideoFramesInFlight, false, false, aFile, sessionId);
+}
+
+nsresult nsScreencastService::StartSession(nsIScreencastServiceClient* aClient, nsIDocShell* aDocShell, uint32_t width, uint32_t height, uint32_t quality, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t offsetTop, uint32_t fps, uint32_t maxFramesInFlight, bool partialFrames, bool rawFrames, const nsACString& videoFile, nsAString& sessionId) {
 
   PresShell* presShell = aDocShell->GetPresShell();
   if (!presShell)
@@ -303,17 +833,6 @@ nsresult nsScreencastService::StartScreencast(nsIScreencastServiceClient* aClien
     return NS_ERROR_UNEXPECTED;
   nsIWidget* widget = widgetListener->GetWidget();
 
-  webrtc::scoped_refptr<webrtc::VideoCaptureModuleEx> capturer = nullptr;
-  for (auto& it : mIdToSession) {
-    capturer = it.second->ReuseCapturer(widget);
-    if (capturer)
-      break;
-  }
-  if (!capturer)
-    capturer = CreateWindowCapturer(widget);
-  if (!capturer)
-    return NS_ERROR_FAILURE;
-
   gfx::IntMargin margin;
   // On Windows the captured frame size is different the window screen size,
   // so we don't try to compute the frame margin.
@@ -333,12 +852,39 @@ nsresult nsScreencastService::StartScreencast(nsIScreencastServiceClient* aClien
   // Crop the image to exclude controls.
   margin.top += offsetTop;
 
+  UniquePtr<IvfVideoWriter> videoWriter;
+  if (!videoFile.IsEmpty()) {
+    videoWriter = IvfVideoWriter::Create(videoFile, width, height, fps);
+    if (!videoWriter)
+      return NS_ERROR_FAILURE;
+  }
+
   nsString uid;
   nsresult rv = generateUid(uid);
   NS_ENSURE_SUCCESS(rv, rv);
   sessionId = uid;
 
-  auto session = Session::Create(aClient, widget, std::move(capturer), width, height, viewportWidth, viewportHeight, margin, quality);
+  // Sessions with the same output share the encoded frames.
+  RefPtr<Encoder> encoder;
+  webrtc::scoped_refptr<webrtc::VideoCaptureModuleEx> capturer = nullptr;
+  for (auto& it : mIdToSession) {
+    Encoder* candidate = it.second->GetEncoder();
+    if (!videoWriter && candidate->Matches(widget, width, height, viewportWidth, viewportHeight, margin, quality, partialFrames, rawFrames)) {
+      encoder = candidate;
+      break;
+    }
+    if (!capturer)
+      capturer = candidate->ReuseCapturer(widget);
+  }
+  if (!encoder) {
+    if (!capturer)
+      capturer = CreateWindowCapturer(widget);
+    if (!capturer)
+      return NS_ERROR_FAILURE;
+    encoder = Encoder::Create(widget, std::move(capturer), width, height, viewportWidth, viewportHeight, margin, quality, partialFrames, rawFrames, std::move(videoWriter));
+  }
+
+  auto session = Session::Create(aClient, std::move(encoder), fps, maxFramesInFlight);
   if (!session->Start())
     return NS_ERROR_FAILURE;
   mIdToSession.emplace(sessionId, std::move(session));
@@ -364,4 +910,13 @@ nsresult nsScreencastService::ScreencastFrameAck(const nsAString& aSessionId) {
   return NS_OK;
 }
 
+nsresult nsScreencastService::GetSessionStats(const nsAString& aSessionId, nsIScreencastSessionStats** aStats) {
+  nsString sessionId(aSessionId);
+  auto it = mIdToSession.find(sessionId);
+  if (it == mIdToSession.end())
+    return NS_ERROR_INVALID_ARG;
+  *aStats = it->second->GetStats().take();
+  return NS_OK;
+}
+
 }  // namespace mozilla
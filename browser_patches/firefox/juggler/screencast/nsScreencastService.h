@@ -22,6 +22,10 @@ class nsScreencastService final : public nsIScreencastService {
  private:
   ~nsScreencastService();
 
+  // Starts a screencast, or a video recording when |videoFile| is set.
+  nsresult StartSession(nsIScreencastServiceClient* aClient, nsIDocShell* aDocShell, uint32_t width, uint32_t height, uint32_t quality, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t offsetTop, uint32_t fps, uint32_t maxFramesInFlight, bool partialFrames, bool rawFrames, const nsACString& videoFile, nsAString& sessionId);
+
+  class Encoder;
   class Session;
   std::map<nsString, RefPtr<Session>> mIdToSession;
 };
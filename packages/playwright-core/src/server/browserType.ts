@@ -204,6 +204,8 @@ export abstract class BrowserType extends SdkObject {
     } = options;
 
     const env = options.env ? envArrayToObject(options.env) : process.env;
+    const pipeCompression = this.supportsPipeFraming() && process.env.PW_PIPE_COMPRESSION === 'deflate';
+    const pipeBinary = this.supportsPipeFraming() && process.env.PW_PIPE_FRAMING === 'binary';
     const prepared = await progress.race(this._prepareToLaunch(options, isPersistent, userDataDir));
 
     // Note: it is important to define these variables before launchProcess, so that we don't get
@@ -214,7 +216,7 @@ export abstract class BrowserType extends SdkObject {
     const { launchedProcess, gracefullyClose, kill } = await progress.race(launchProcess({
       command: prepared.executable,
       args: prepared.browserArguments,
-      env: this.amendEnvironment(env, prepared.userDataDir, isPersistent, options),
+      env: { ...this.amendEnvironment(env, prepared.userDataDir, isPersistent, options), PW_PIPE_COMPRESSION: pipeCompression ? 'deflate' : undefined, PW_PIPE_FRAMING: pipeBinary ? 'binary' : undefined },
       handleSIGINT,
       handleSIGTERM,
       handleSIGHUP,
@@ -275,7 +277,7 @@ export abstract class BrowserType extends SdkObject {
         transport = await WebSocketTransport.connect(progress, wsEndpoint!);
       } else {
         const stdio = launchedProcess.stdio as unknown as [NodeJS.ReadableStream, NodeJS.WritableStream, NodeJS.WritableStream, NodeJS.WritableStream, NodeJS.ReadableStream];
-        transport = new PipeTransport(stdio[3], stdio[4]);
+        transport = new PipeTransport(stdio[3], stdio[4], { compression: pipeCompression, binary: pipeBinary });
       }
       return { browserProcess, artifactsDir: prepared.artifactsDir, userDataDir: prepared.userDataDir, transport, wsEndpoint };
     } catch (error) {
@@ -339,6 +341,10 @@ export abstract class BrowserType extends SdkObject {
     return true;
   }
 
+  supportsPipeFraming(): boolean {
+    return false;
+  }
+
   getExecutableName(options: types.LaunchOptions): string {
     return options.channel || this._name;
   }
@@ -96,7 +96,7 @@ export class FFNetworkManager {
       });
       if (response.evicted)
         throw new Error(`Response body for ${request.request.method()} ${request.request.url()} was evicted!`);
-      return Buffer.from(response.base64body, 'base64');
+      return typeof response.base64body === 'string' ? Buffer.from(response.base64body, 'base64') : response.base64body;
     };
 
     const startTime = event.timing.startTime;
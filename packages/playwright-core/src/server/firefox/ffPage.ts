@@ -549,7 +549,7 @@ export class FFPage implements PageDelegate {
   }
 
   private _onScreencastFrame(event: Protocol.Page.screencastFramePayload) {
-    const buffer = Buffer.from(event.data, 'base64');
+    const buffer = typeof event.data === 'string' ? Buffer.from(event.data, 'base64') : event.data;
     void this._page.screencast.onScreencastFrame({
       buffer,
       frameSwapWallTime: event.timestamp * 1000, // timestamp is in seconds, we need to convert to milliseconds.
@@ -78,6 +78,10 @@ export class Firefox extends BrowserType {
     return env;
   }
 
+  override supportsPipeFraming(): boolean {
+    return true;
+  }
+
   override attemptToGracefullyCloseBrowser(transport: ConnectionTransport): void {
     // Note that it's fine to reuse the transport, since our connection ignores kBrowserCloseMessageId.
     const message = { method: 'Browser.close', params: {}, id: kBrowserCloseMessageId };
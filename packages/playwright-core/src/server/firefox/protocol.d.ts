@@ -40,6 +40,23 @@ export namespace Protocol {
       longitude: number;
       accuracy?: number;
     };
+    export type TransportStats = {
+      elapsedSeconds: number;
+      messagesRead: number;
+      bytesRead: number;
+      bytesReadPerSecond: number;
+      largestMessageRead: number;
+      messagesWritten: number;
+      bytesWritten: number;
+      bytesWrittenPerSecond: number;
+      largestMessageWritten: number;
+      writeCalls: number;
+      queueDepth: number;
+      maxQueueDepth: number;
+      latencyBucketBoundsMs: number[];
+      dispatchLatency: number[];
+      waitLatency: number[];
+    };
     export type DownloadOptions = {
       behavior?: ("saveToDisk"|"cancel");
       downloadsDir?: string;
@@ -101,6 +118,26 @@ export namespace Protocol {
       userAgent: string;
       version: string;
     };
+    export type getTransportStatsParameters = void;
+    export type getTransportStatsReturnValue = {
+      stats: {
+        elapsedSeconds: number;
+        messagesRead: number;
+        bytesRead: number;
+        bytesReadPerSecond: number;
+        largestMessageRead: number;
+        messagesWritten: number;
+        bytesWritten: number;
+        bytesWrittenPerSecond: number;
+        largestMessageWritten: number;
+        writeCalls: number;
+        queueDepth: number;
+        maxQueueDepth: number;
+        latencyBucketBoundsMs: number[];
+        dispatchLatency: number[];
+        waitLatency: number[];
+      };
+    };
     export type setExtraHTTPHeadersParameters = {
       browserContextId?: string;
       headers: {
@@ -314,6 +351,9 @@ export namespace Protocol {
         width: number;
         height: number;
         quality: number;
+        fps?: number;
+        maxFramesInFlight?: number;
+        partialFrames?: boolean;
       };
     };
     export type setScreencastOptionsReturnValue = void;
@@ -386,6 +426,23 @@ export namespace Protocol {
       width: number;
       height: number;
     };
+    export type ScreencastTile = {
+      x: number;
+      y: number;
+      width: number;
+      height: number;
+      data: string|Buffer;
+    };
+    export type ScreencastStats = {
+      framesEncoded: number;
+      framesDropped: number;
+      meanLatencyMs: number;
+      maxLatencyMs: number;
+      meanEncodeMs: number;
+      heapAllocations: number;
+      ackLatencyMs: number;
+      frameIntervalMs: number;
+    };
     export type InitScript = {
       script: string;
       worldName?: string;
@@ -506,7 +563,19 @@ export namespace Protocol {
       timestamp: number;
     }
     export type screencastFramePayload = {
-      data: string;
+      data: string|Buffer;
+      deviceWidth: number;
+      deviceHeight: number;
+      timestamp: number;
+    }
+    export type screencastTilesPayload = {
+      tiles: {
+        x: number;
+        y: number;
+        width: number;
+        height: number;
+        data: string|Buffer;
+      }[];
       deviceWidth: number;
       deviceHeight: number;
       timestamp: number;
@@ -735,12 +804,37 @@ export namespace Protocol {
       width: number;
       height: number;
       quality: number;
+      fps?: number;
+      maxFramesInFlight?: number;
+      partialFrames?: boolean;
     };
     export type startScreencastReturnValue = void;
     export type screencastFrameAckParameters = void;
     export type screencastFrameAckReturnValue = void;
     export type stopScreencastParameters = void;
     export type stopScreencastReturnValue = void;
+    export type getScreencastStatsParameters = void;
+    export type getScreencastStatsReturnValue = {
+      stats: {
+        framesEncoded: number;
+        framesDropped: number;
+        meanLatencyMs: number;
+        maxLatencyMs: number;
+        meanEncodeMs: number;
+        heapAllocations: number;
+        ackLatencyMs: number;
+        frameIntervalMs: number;
+      };
+    };
+    export type startVideoRecordingParameters = {
+      file: string;
+      width: number;
+      height: number;
+      fps?: number;
+    };
+    export type startVideoRecordingReturnValue = void;
+    export type stopVideoRecordingParameters = void;
+    export type stopVideoRecordingReturnValue = void;
   }
   export namespace Runtime {
     export type RemoteObject = {
@@ -998,7 +1092,7 @@ export namespace Protocol {
       requestId: string;
     };
     export type getResponseBodyReturnValue = {
-      base64body: string;
+      base64body: string|Buffer;
       evicted?: boolean;
     };
   }
@@ -1032,6 +1126,7 @@ export namespace Protocol {
     ["Page.webSocketFrameSent"]: [Page.webSocketFrameSentPayload];
     ["Page.webSocketFrameReceived"]: [Page.webSocketFrameReceivedPayload];
     ["Page.screencastFrame"]: [Page.screencastFramePayload];
+    ["Page.screencastTiles"]: [Page.screencastTilesPayload];
     ["Runtime.executionContextCreated"]: [Runtime.executionContextCreatedPayload];
     ["Runtime.executionContextDestroyed"]: [Runtime.executionContextDestroyedPayload];
     ["Runtime.executionContextsCleared"]: [Runtime.executionContextsClearedPayload];
@@ -1048,6 +1143,7 @@ export namespace Protocol {
     "Browser.newPage": Browser.newPageParameters;
     "Browser.close": Browser.closeParameters;
     "Browser.getInfo": Browser.getInfoParameters;
+    "Browser.getTransportStats": Browser.getTransportStatsParameters;
     "Browser.setExtraHTTPHeaders": Browser.setExtraHTTPHeadersParameters;
     "Browser.clearCache": Browser.clearCacheParameters;
     "Browser.setBrowserProxy": Browser.setBrowserProxyParameters;
@@ -1112,6 +1208,9 @@ export namespace Protocol {
     "Page.startScreencast": Page.startScreencastParameters;
     "Page.screencastFrameAck": Page.screencastFrameAckParameters;
     "Page.stopScreencast": Page.stopScreencastParameters;
+    "Page.getScreencastStats": Page.getScreencastStatsParameters;
+    "Page.startVideoRecording": Page.startVideoRecordingParameters;
+    "Page.stopVideoRecording": Page.stopVideoRecordingParameters;
     "Runtime.evaluate": Runtime.evaluateParameters;
     "Runtime.callFunction": Runtime.callFunctionParameters;
     "Runtime.disposeObject": Runtime.disposeObjectParameters;
@@ -1130,6 +1229,7 @@ export namespace Protocol {
     "Browser.newPage": Browser.newPageReturnValue;
     "Browser.close": Browser.closeReturnValue;
     "Browser.getInfo": Browser.getInfoReturnValue;
+    "Browser.getTransportStats": Browser.getTransportStatsReturnValue;
     "Browser.setExtraHTTPHeaders": Browser.setExtraHTTPHeadersReturnValue;
     "Browser.clearCache": Browser.clearCacheReturnValue;
     "Browser.setBrowserProxy": Browser.setBrowserProxyReturnValue;
@@ -1194,6 +1294,9 @@ export namespace Protocol {
     "Page.startScreencast": Page.startScreencastReturnValue;
     "Page.screencastFrameAck": Page.screencastFrameAckReturnValue;
     "Page.stopScreencast": Page.stopScreencastReturnValue;
+    "Page.getScreencastStats": Page.getScreencastStatsReturnValue;
+    "Page.startVideoRecording": Page.startVideoRecordingReturnValue;
+    "Page.stopVideoRecording": Page.stopVideoRecordingReturnValue;
     "Runtime.evaluate": Runtime.evaluateReturnValue;
     "Runtime.callFunction": Runtime.callFunctionReturnValue;
     "Runtime.disposeObject": Runtime.disposeObjectReturnValue;
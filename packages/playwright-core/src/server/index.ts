@@ -26,6 +26,7 @@ export { Request, Response } from './network';
 export { Page, Worker } from './page';
 export { createPlaywright } from './playwright';
 export { nullProgress } from './progress';
+export { PipeTransport } from './pipeTransport';
 export { WebSocketTransport } from './transport';
 export { installRootRedirect, openTraceInBrowser, openTraceViewerApp, startTraceViewerServer, runTraceViewerApp } from './trace/viewer/traceViewer';
 
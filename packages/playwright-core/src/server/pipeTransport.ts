@@ -15,24 +15,53 @@
  * limitations under the License.
  */
 
+import zlib from 'zlib';
+
 import { debugLogger } from '@utils/debugLogger';
 import { makeWaitForNextTask } from '@utils/task';
 
 import type { ConnectionTransport, ProtocolRequest, ProtocolResponse } from './transport';
 
+// Browsers launched with PW_PIPE_FRAMING=binary or PW_PIPE_COMPRESSION=deflate offer
+// framing by sending this message first. We answer with the same message and frame
+// everything we write after that. The browser keeps sending '\0' terminated messages
+// until it reads our answer, then sends the message again and frames everything after
+// it. A frame is a little endian uint32 header followed by the payload:
+// - bits 0-29 hold the payload size,
+// - bit 30 marks a binary attachment of the next message, which refers to it as
+//   {"$binary": <index>},
+// - bit 31 marks a compressed payload: the uint32 size of the message followed by
+//   its zlib stream.
+const kFramingHandshake = '{"pipeFraming":1}';
+const kFrameHeaderSize = 4;
+const kFrameCompressed = 0x80000000;
+const kFrameAttachment = 0x40000000;
+const kFrameSizeMask = 0x3fffffff;
+// Smaller messages do not shrink enough to be worth compressing.
+const kMinCompressedSize = 1024;
+
 export class PipeTransport implements ConnectionTransport {
   private _pipeRead: NodeJS.ReadableStream;
   private _pipeWrite: NodeJS.WritableStream;
   private _pendingBuffers: Buffer[] = [];
+  private _pendingLength = 0;
+  private _nextFrameLength = kFrameHeaderSize;
   private _waitForNextTask = makeWaitForNextTask();
   private _closed = false;
   private _onclose?: (reason?: string) => void;
+  private _acceptFraming: boolean;
+  private _compress: boolean;
+  private _framedWrites = false;
+  private _framedReads = false;
+  private _attachments: Buffer[] = [];
 
   onmessage?: (message: ProtocolResponse) => void;
 
-  constructor(pipeWrite: NodeJS.WritableStream, pipeRead: NodeJS.ReadableStream) {
+  constructor(pipeWrite: NodeJS.WritableStream, pipeRead: NodeJS.ReadableStream, options: { compression?: boolean, binary?: boolean } = {}) {
     this._pipeRead = pipeRead;
     this._pipeWrite = pipeWrite;
+    this._compress = !!options.compression;
+    this._acceptFraming = this._compress || !!options.binary;
     pipeRead.on('data', buffer => this._dispatch(buffer));
     pipeRead.on('close', () => {
       this._closed = true;
@@ -57,6 +86,10 @@ export class PipeTransport implements ConnectionTransport {
   send(message: ProtocolRequest) {
     if (this._closed)
       throw new Error('Pipe has been closed');
+    if (this._framedWrites) {
+      this._pipeWrite.write(encodeFrame(Buffer.from(JSON.stringify(message)), this._compress));
+      return;
+    }
     this._pipeWrite.write(JSON.stringify(message));
     this._pipeWrite.write('\0');
   }
@@ -66,29 +99,91 @@ export class PipeTransport implements ConnectionTransport {
   }
 
   _dispatch(buffer: Buffer) {
+    if (this._framedReads) {
+      this._dispatchFrames(buffer);
+      return;
+    }
     let end = buffer.indexOf('\0');
     if (end === -1) {
       this._pendingBuffers.push(buffer);
       return;
     }
     this._pendingBuffers.push(buffer.slice(0, end));
-    const message = Buffer.concat(this._pendingBuffers).toString();
-    this._waitForNextTask(() => {
-      if (this.onmessage)
-        this.onmessage.call(null, JSON.parse(message));
-    });
-
+    let message = Buffer.concat(this._pendingBuffers).toString();
     let start = end + 1;
-    end = buffer.indexOf('\0', start);
-    while (end !== -1) {
-      const message = buffer.toString(undefined, start, end);
-      this._waitForNextTask(() => {
-        if (this.onmessage)
-          this.onmessage.call(null, JSON.parse(message));
-      });
-      start = end + 1;
+    while (true) {
+      if (this._acceptFraming && message === kFramingHandshake && !this._framedWrites) {
+        this._pipeWrite.write(kFramingHandshake);
+        this._pipeWrite.write('\0');
+        this._framedWrites = true;
+      } else if (this._framedWrites && message === kFramingHandshake) {
+        // The browser read our answer, the rest of the input is frames.
+        this._framedReads = true;
+        this._pendingBuffers = [];
+        this._dispatchFrames(buffer.slice(start));
+        return;
+      } else {
+        this._dispatchMessage(message);
+      }
       end = buffer.indexOf('\0', start);
+      if (end === -1)
+        break;
+      message = buffer.toString(undefined, start, end);
+      start = end + 1;
     }
     this._pendingBuffers = [buffer.slice(start)];
   }
+
+  private _dispatchFrames(buffer: Buffer) {
+    this._pendingBuffers.push(buffer);
+    this._pendingLength += buffer.length;
+    // Only join the chunks once the next frame is complete.
+    if (this._pendingLength < this._nextFrameLength)
+      return;
+    const data = Buffer.concat(this._pendingBuffers, this._pendingLength);
+    let start = 0;
+    while (data.length - start >= kFrameHeaderSize) {
+      const header = data.readUInt32LE(start);
+      const end = start + kFrameHeaderSize + (header & kFrameSizeMask);
+      if (end > data.length)
+        break;
+      const payload = data.subarray(start + kFrameHeaderSize, end);
+      if (header & kFrameAttachment) {
+        this._attachments.push(payload);
+      } else {
+        this._dispatchMessage((header & kFrameCompressed) ? zlib.inflateSync(payload.subarray(4)).toString() : payload.toString(), this._attachments);
+        this._attachments = [];
+      }
+      start = end;
+    }
+    const rest = data.subarray(start);
+    this._pendingBuffers = [rest];
+    this._pendingLength = rest.length;
+    this._nextFrameLength = rest.length >= kFrameHeaderSize ? kFrameHeaderSize + (rest.readUInt32LE(0) & kFrameSizeMask) : kFrameHeaderSize;
+  }
+
+  private _dispatchMessage(message: string, attachments: Buffer[] = []) {
+    this._waitForNextTask(() => {
+      if (!this.onmessage)
+        return;
+      // Attachments stand in for Base64 strings, consumers take either.
+      const reviver = (key: string, value: any) => value && typeof value === 'object' && typeof value.$binary === 'number' ? attachments[value.$binary] : value;
+      this.onmessage.call(null, attachments.length ? JSON.parse(message, reviver) : JSON.parse(message));
+    });
+  }
+}
+
+function encodeFrame(message: Buffer, compress: boolean): Buffer {
+  if (compress && message.length >= kMinCompressedSize) {
+    const compressed = zlib.deflateSync(message, { level: zlib.constants.Z_BEST_SPEED });
+    if (compressed.length + 4 < message.length) {
+      const header = Buffer.alloc(kFrameHeaderSize + 4);
+      header.writeUInt32LE((compressed.length + 4 | kFrameCompressed) >>> 0, 0);
+      header.writeUInt32LE(message.length, kFrameHeaderSize);
+      return Buffer.concat([header, compressed]);
+    }
+  }
+  const header = Buffer.alloc(kFrameHeaderSize);
+  header.writeUInt32LE(message.length, 0);
+  return Buffer.concat([header, message]);
 }
@@ -7297,6 +7297,49 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
        */
       accuracy: number;
     }
+    /**
+     * Counters of the remote inspector pipe.
+     */
+    export interface TransportStats {
+      /**
+       * Time since the pipe was opened.
+       */
+      elapsedSeconds: number;
+      messagesRead: number;
+      bytesRead: number;
+      bytesReadPerSecond: number;
+      largestMessageRead: number;
+      messagesWritten: number;
+      bytesWritten: number;
+      bytesWrittenPerSecond: number;
+      largestMessageWritten: number;
+      /**
+       * Messages waiting for the writer.
+       */
+      queueDepth: number;
+      maxQueueDepth: number;
+      /**
+       * Bytes waiting for the writer.
+       */
+      queuedBytes: number;
+      maxQueuedBytes: number;
+      /**
+       * Number of times the queue grew large enough to throttle screencast frames.
+       */
+      backpressureCount: number;
+      /**
+       * Upper bounds of the histogram buckets, the last bucket has none.
+       */
+      latencyBucketBoundsMs: number[];
+      /**
+       * Time from scheduling delivery of incoming messages to it starting.
+       */
+      dispatchLatency: number[];
+      /**
+       * Time from reading a message off the pipe to dispatching it.
+       */
+      waitLatency: number[];
+    }
     
     export type pageProxyCreatedPayload = {
       /**
@@ -7377,6 +7420,11 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
        */
       os: string;
     }
+    export type getTransportStatsParameters = {
+    }
+    export type getTransportStatsReturnValue = {
+      stats: TransportStats;
+    }
     /**
      * Close browser.
      */
@@ -8529,6 +8577,10 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
      * Unique identifier of the screencast.
      */
     export type ScreencastId = string;
+    /**
+     * Encoding of screencast frames.
+     */
+    export type ScreencastFormat = "jpeg"|"webp";
     
     export type screencastFramePayload = {
       /**
@@ -8538,6 +8590,14 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
       timestamp: number;
       deviceWidth: number;
       deviceHeight: number;
+      /**
+       * Width of the encoded image.
+       */
+      imageWidth: number;
+      /**
+       * Height of the encoded image.
+       */
+      imageHeight: number;
     }
     
     /**
@@ -8547,7 +8607,22 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
       width: number;
       height: number;
       toolbarHeight: number;
+      /**
+       * Compression quality from 0 to 100.
+       */
       quality: number;
+      /**
+       * Defaults to "jpeg". "webp" is not supported on macOS.
+       */
+      format?: ScreencastFormat;
+      /**
+       * Frames sent but not acknowledged yet before new paints are skipped. Defaults to 2.
+       */
+      maxFramesInFlight?: number;
+      /**
+       * Capture rate cap on platforms that poll for frames. Defaults to 25.
+       */
+      maxFps?: number;
     }
     export type startScreencastReturnValue = {
       /**
@@ -8561,6 +8636,14 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
     export type stopScreencastParameters = {
     }
     export type stopScreencastReturnValue = {
+      /**
+       * Frames encoded and sent.
+       */
+      encodedFrames: number;
+      /**
+       * Frames skipped because nothing changed since the previous one.
+       */
+      unchangedFrames: number;
     }
     export type screencastFrameAckParameters = {
       /**
@@ -9688,6 +9771,7 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
     "Playwright.enable": Playwright.enableParameters;
     "Playwright.disable": Playwright.disableParameters;
     "Playwright.getInfo": Playwright.getInfoParameters;
+    "Playwright.getTransportStats": Playwright.getTransportStatsParameters;
     "Playwright.close": Playwright.closeParameters;
     "Playwright.createContext": Playwright.createContextParameters;
     "Playwright.deleteContext": Playwright.deleteContextParameters;
@@ -9998,6 +10082,7 @@ the top of the viewport and Y increases as it proceeds towards the bottom of the
     "Playwright.enable": Playwright.enableReturnValue;
     "Playwright.disable": Playwright.disableReturnValue;
     "Playwright.getInfo": Playwright.getInfoReturnValue;
+    "Playwright.getTransportStats": Playwright.getTransportStatsReturnValue;
     "Playwright.close": Playwright.closeReturnValue;
     "Playwright.createContext": Playwright.createContextReturnValue;
     "Playwright.deleteContext": Playwright.deleteContextReturnValue;
@@ -65,6 +65,10 @@ export class WebKit extends BrowserType {
     return options.channel !== 'webkit-wsl';
   }
 
+  override supportsPipeFraming(): boolean {
+    return true;
+  }
+
   override async resolveExecutablePath(options: types.LaunchOptions): Promise<string | undefined> {
     if (options.channel !== 'webkit-wsl')
       return super.resolveExecutablePath(options);
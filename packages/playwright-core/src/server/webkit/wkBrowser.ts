@@ -163,7 +163,8 @@ export class WKBrowser extends Browser {
     if (!context)
       return;
     const pageProxySession = new WKSession(this._connection, pageProxyId, (message: any) => {
-      this._connection.rawSend({ ...message, pageProxyId });
+      // The browser finds pageProxyId without parsing the command, keep it first.
+      this._connection.rawSend({ pageProxyId, ...message });
     });
     const opener = event.openerId ? this._wkPages.get(event.openerId) : undefined;
     const wkPage = new WKPage(context, pageProxySession, opener || null);
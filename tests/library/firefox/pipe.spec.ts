@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) Microsoft Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import { browserTest as it, expect } from '../../config/browserTest';
+
+it.skip(({ mode }) => mode !== 'default', 'talks to the juggler session directly');
+
+it('should read multi-megabyte non-ascii messages intact', async ({ browser, toImpl }) => {
+  const page = await browser.newPage();
+  // 4 MiB of UTF-8 spans many pipe reads, and multi-byte characters straddle read boundaries.
+  const text = 'a€\u{1F600}'.repeat(512 * 1024);
+  const [length, head, tail] = await page.evaluate(text => [text.length, text.slice(0, 4), text.slice(-4)], text);
+  expect(length).toBe(text.length);
+  expect(head).toBe(text.slice(0, 4));
+  expect(tail).toBe(text.slice(-4));
+
+  const { stats } = await toImpl(browser).session.send('Browser.getTransportStats');
+  expect(stats.largestMessageRead).toBeGreaterThan(Buffer.byteLength(text));
+  await page.close();
+});
+
+it('should split messages that arrive in the same read', async ({ browser }) => {
+  const page = await browser.newPage();
+  const results = await Promise.all(Array.from({ length: 200 }, (_, i) => page.evaluate(i => i * 2, i)));
+  expect(results).toEqual(Array.from({ length: 200 }, (_, i) => i * 2));
+  await page.close();
+});
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) Microsoft Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import { browserTest as it, expect } from '../../config/browserTest';
+import { ensureSomeFrames } from '../../config/utils';
+
+it.skip(({ mode }) => mode !== 'default', 'talks to the juggler session directly');
+it.skip(({ video }) => video === 'on', 'conflicts with built-in video recording');
+it.skip(({ trace }) => trace === 'on', 'trace=on screencasts at the browser context level');
+
+it('should not allocate encoder buffers per frame', async ({ browser, server, toImpl }) => {
+  it.slow();
+  const size = { width: 500, height: 400 };
+  const context = await browser.newContext({ viewport: size });
+  const page = await context.newPage();
+  const session = toImpl(page).delegate._session;
+  await page.goto(server.EMPTY_PAGE);
+  await page.screencast.start({ onFrame: () => {}, size });
+
+  const repaint = async () => {
+    for (const color of ['red', 'blue', 'green', 'red']) {
+      await page.evaluate(color => document.body.style.backgroundColor = color, color);
+      await ensureSomeFrames(page);
+    }
+  };
+  // The first frames size the buffers for this geometry.
+  await repaint();
+  const { stats: warm } = await session.send('Page.getScreencastStats');
+  expect(warm.framesEncoded).toBeGreaterThan(0);
+
+  await repaint();
+  const { stats } = await session.send('Page.getScreencastStats');
+  expect(stats.framesEncoded).toBeGreaterThan(warm.framesEncoded);
+  expect(stats.heapAllocations).toBe(warm.heapAllocations);
+
+  await page.screencast.stop();
+  await context.close();
+});
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) Microsoft Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import fs from 'fs';
+import { browserTest as it, expect } from '../../config/browserTest';
+import { ensureSomeFrames } from '../../config/utils';
+import { VideoPlayer } from '../videoPlayer';
+
+it.skip(({ mode }) => mode !== 'default', 'talks to the juggler session directly');
+it.skip(({ video }) => video === 'on', 'conflicts with built-in video recording');
+
+it('should record a complete ivf video in the browser', async ({ browser, toImpl }, testInfo) => {
+  it.slow();
+  const size = { width: 320, height: 240 };
+  const context = await browser.newContext({ viewport: size });
+  const page = await context.newPage();
+  const session = toImpl(page).delegate._session;
+  const videoPath = testInfo.outputPath('video.ivf');
+
+  await session.send('Page.startVideoRecording', { file: videoPath, ...size });
+  await page.evaluate(() => document.body.style.backgroundColor = 'red');
+  await ensureSomeFrames(page);
+  await session.send('Page.stopVideoRecording');
+  await context.close();
+
+  const data = fs.readFileSync(videoPath);
+  expect(data.toString('latin1', 0, 4)).toBe('DKIF');
+  expect(data.toString('latin1', 8, 12)).toBe('VP80');
+  expect(data.readUInt16LE(12)).toBe(size.width);
+  expect(data.readUInt16LE(14)).toBe(size.height);
+
+  // The header is rewritten on stop, its frame count must cover every frame
+  // in the file, including those drained from the encoder.
+  let frames = 0;
+  for (let offset = data.readUInt16LE(6); offset + 12 <= data.length; offset += 12 + data.readUInt32LE(offset))
+    ++frames;
+  expect(frames).toBeGreaterThan(0);
+  expect(data.readUInt32LE(24)).toBe(frames);
+
+  const videoPlayer = new VideoPlayer(videoPath);
+  expect(videoPlayer.videoWidth).toBe(size.width);
+  expect(videoPlayer.videoHeight).toBe(size.height);
+  const pixels = videoPlayer.seekLastFrame().data;
+  for (let i = 0; i < pixels.length; i += 4) {
+    expect(pixels[i]).toBeGreaterThan(185);
+    expect(pixels[i + 1]).toBeLessThan(70);
+    expect(pixels[i + 2]).toBeLessThan(70);
+  }
+});
@@ -16,6 +16,7 @@
 
 import fs from 'fs';
 import path from 'path';
+import { jpegjs } from 'playwright-core/lib/utilsBundle';
 import { expect, browserTest as test } from '../config/browserTest';
 import { ensureSomeFrames } from '../config/utils';
 import { kTargetClosedErrorMessage } from '../config/errors';
@@ -54,6 +55,36 @@ test('screencast.start delivers frames via onFrame callback', async ({ browser,
   await context.close();
 });
 
+test('screencast frames contain only the page, edge to edge', async ({ browser, server, trace, browserName, isMac, headless }) => {
+  test.skip(trace === 'on', 'trace=on has different screencast image configuration');
+  test.fixme(browserName === 'firefox' && isMac && !headless, 'wrong frame size in headed Firefox on Mac');
+
+  const context = await browser.newContext({ viewport: { width: 600, height: 300 } });
+  const page = await context.newPage();
+  await page.goto(server.EMPTY_PAGE);
+  await page.evaluate(() => document.body.style.backgroundColor = 'red');
+
+  const frames: Buffer[] = [];
+  await page.screencast.start({ onFrame: ({ data }) => frames.push(data), size: { width: 300, height: 300 } });
+  await ensureSomeFrames(page);
+  await page.screencast.stop();
+
+  expect(frames.length).toBeGreaterThan(0);
+  const { width, height, data } = jpegjs.decode(frames[frames.length - 1]);
+  expect({ width, height }).toEqual({ width: 300, height: 150 });
+  // Window chrome or borders scaled into the frame would show up along its edges.
+  const edges: Buffer[] = [];
+  for (const y of [1, height - 2])
+    edges.push(data.subarray(y * width * 4, (y + 1) * width * 4));
+  for (let y = 0; y < height; ++y) {
+    edges.push(data.subarray((y * width + 1) * 4, (y * width + 2) * 4));
+    edges.push(data.subarray((y * width + width - 2) * 4, (y * width + width - 1) * 4));
+  }
+  expectAll(Buffer.concat(edges), isAlmostRed);
+
+  await context.close();
+});
+
 test('applies backpressure while async onFrame callback is pending', async ({ browser, server, trace }) => {
   test.skip(trace === 'on', 'trace recording acknowledges screencast frames independently');
 
@@ -153,6 +184,34 @@ test('start allows restart with different options after stop', async ({ browser,
   await context.close();
 });
 
+test('restarted screencast encodes frames at the new size', async ({ browser, server, trace, browserName, isMac, headless }) => {
+  test.skip(trace === 'on', 'trace=on has different screencast image configuration');
+  test.fixme(browserName === 'firefox' && isMac && !headless, 'wrong frame size in headed Firefox on Mac');
+
+  const context = await browser.newContext({ viewport: { width: 500, height: 400 } });
+  const page = await context.newPage();
+  await page.goto(server.EMPTY_PAGE);
+
+  // Sessions keep their JPEG encoder and buffers, a new geometry must not reuse stale ones.
+  for (const [size, expected] of [
+    [{ width: 500, height: 400 }, { width: 500, height: 400 }],
+    [{ width: 250, height: 400 }, { width: 250, height: 200 }],
+    [{ width: 500, height: 400 }, { width: 500, height: 400 }],
+  ]) {
+    const frames: Buffer[] = [];
+    await page.screencast.start({ onFrame: ({ data }) => frames.push(data), size });
+    await page.evaluate(() => document.body.style.backgroundColor = document.body.style.backgroundColor === 'red' ? 'blue' : 'red');
+    await ensureSomeFrames(page);
+    await page.screencast.stop();
+
+    expect(frames.length).toBeGreaterThan(0);
+    for (const frame of frames)
+      expect(jpegDimensions(frame)).toEqual(expected);
+  }
+
+  await context.close();
+});
+
 test('start returns a disposable that stops screencast', async ({ browser, server, trace }) => {
   test.skip(trace === 'on', 'trace=on has different screencast image configuration');
   const context = await browser.newContext({ viewport: { width: 500, height: 400 } });
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) Microsoft Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import { PassThrough } from 'stream';
+import { test as it, expect } from '@playwright/test';
+import { server as coreServer } from '../../../packages/playwright-core/lib/coreBundle';
+
+const { PipeTransport } = coreServer;
+
+const handshake = '{"pipeFraming":1}';
+
+function createPipes(options?: { binary?: boolean }) {
+  // |toDriver| is what the browser writes, |fromDriver| collects what the driver writes.
+  const toDriver = new PassThrough();
+  const fromDriver = new PassThrough();
+  const written: Buffer[] = [];
+  fromDriver.on('data', chunk => written.push(chunk));
+  const transport = new PipeTransport(fromDriver, toDriver, options);
+  const received: any[] = [];
+  transport.onmessage = message => received.push(message);
+  return { toDriver, transport, received, written: () => Buffer.concat(written) };
+}
+
+function frame(message: object): Buffer {
+  const payload = Buffer.from(JSON.stringify(message));
+  const header = Buffer.alloc(4);
+  header.writeUInt32LE(payload.length, 0);
+  return Buffer.concat([header, payload]);
+}
+
+it('should answer a framing offer and read frames once the browser switches', async () => {
+  const { toDriver, transport, received, written } = createPipes({ binary: true });
+  toDriver.write(handshake + '\0');
+  await expect.poll(() => written().toString()).toBe(handshake + '\0');
+
+  // The browser keeps terminating messages until it reads the answer.
+  toDriver.write(JSON.stringify({ id: 1 }) + '\0');
+  await expect.poll(() => received).toEqual([{ id: 1 }]);
+
+  toDriver.write(Buffer.concat([Buffer.from(handshake + '\0'), frame({ id: 2 })]));
+  toDriver.write(frame({ id: 3 }));
+  await expect.poll(() => received).toEqual([{ id: 1 }, { id: 2 }, { id: 3 }]);
+
+  transport.send({ id: 4, method: 'Browser.close', params: {} });
+  await expect.poll(() => written().length).toBeGreaterThan(handshake.length + 1);
+  const sent = written().subarray(handshake.length + 1);
+  expect(sent.readUInt32LE(0)).toBe(sent.length - 4);
+  expect(JSON.parse(sent.subarray(4).toString())).toEqual({ id: 4, method: 'Browser.close', params: {} });
+});
+
+it('should keep terminated messages when the browser does not offer framing', async () => {
+  const { toDriver, transport, received, written } = createPipes({ binary: true });
+  transport.send({ id: 1, method: 'Browser.enable', params: {} });
+  toDriver.write(JSON.stringify({ id: 1 }) + '\0');
+  await expect.poll(() => received).toEqual([{ id: 1 }]);
+  await expect.poll(() => written().toString()).toBe(JSON.stringify({ id: 1, method: 'Browser.enable', params: {} }) + '\0');
+});
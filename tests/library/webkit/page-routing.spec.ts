@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) Microsoft Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import { browserTest as it, expect } from '../../config/browserTest';
+
+// Page messages get the routing ids spliced in ahead of their own properties,
+// nothing in the message itself may be altered or mistaken for them.
+const payload = {
+  pageProxyId: 'not-a-page',
+  browserContextId: '{"browserContextId":"x"}',
+  text: '}{"pageProxyId":"y",',
+  nested: { pageProxyId: ['{', '}'], unicode: 'ü€\u{1F600}' },
+};
+
+it('should route responses without altering them', async ({ browser }) => {
+  const page = await browser.newPage();
+  expect(await page.evaluate(payload => payload, payload)).toEqual(payload);
+  await page.close();
+});
+
+it('should route events without altering them', async ({ browser }) => {
+  const page = await browser.newPage();
+  const [message] = await Promise.all([
+    page.waitForEvent('console'),
+    page.evaluate(payload => console.log(JSON.stringify(payload)), payload),
+  ]);
+  expect(JSON.parse(message.text())).toEqual(payload);
+  await page.close();
+});
+
+it('should route messages to the page they came from', async ({ browser }) => {
+  const contexts = await Promise.all([browser.newContext(), browser.newContext()]);
+  const pages = await Promise.all(contexts.map(context => context.newPage()));
+  const messages: string[][] = pages.map(() => []);
+  pages.forEach((page, i) => page.on('console', message => messages[i].push(message.text())));
+
+  const results = await Promise.all(pages.map((page, i) => page.evaluate(i => {
+    console.log('page' + i);
+    return i;
+  }, i)));
+  expect(results).toEqual([0, 1]);
+  await expect.poll(() => messages).toEqual([['page0'], ['page1']]);
+  await Promise.all(contexts.map(context => context.close()));
+});
+
+it('should report an error for page commands without an id', async ({ browser, toImpl }) => {
+  const page = await browser.newPage({ viewport: { width: 500, height: 500 } });
+  const connection = toImpl(browser)._connection;
+  const transport = connection._transport;
+  const onmessage = transport.onmessage;
+  const received: any[] = [];
+  transport.onmessage = (message: any) => {
+    received.push(message);
+    onmessage(message);
+  };
+  const pageProxyId = toImpl(page).delegate._pageProxySession.sessionId;
+  connection.rawSend({ pageProxyId, method: 'Emulation.setDeviceMetricsOverride', params: { width: 300, height: 300, fixedLayout: false, deviceScaleFactor: 1 } });
+  await expect.poll(() => received.some(message => message.error && message.id === undefined)).toBe(true);
+  transport.onmessage = onmessage;
+  expect(await page.evaluate(() => window.innerWidth)).toBe(500);
+  await page.close();
+});
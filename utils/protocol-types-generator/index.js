@@ -176,6 +176,7 @@ async function generateFirefoxProtocol(executablePath) {
     }
     const t = {};
     t.String = {"$type": "string"};
+    t.Binary = {"$type": "string|Buffer"};
     t.Number = {"$type": "number"};
     t.Boolean = {"$type": "boolean"};
     t.Undefined = {"$type": "undefined"};